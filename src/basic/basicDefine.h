@@ -18,5 +18,19 @@ namespace KAFKA {
 #define KAFKA_NAMESPACE_END \
 }
 
+//分支预测提示，cold函数编译到单独的代码段，不占用热路径的指令缓存
+#if defined(__GNUC__) || defined(__clang__)
+#define KAFKA_LIKELY(x) __builtin_expect(!!(x), 1)
+#define KAFKA_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define KAFKA_COLD __attribute__((cold, noinline))
+//不内联到调用点，但按正常的优化级别编译
+#define KAFKA_NOINLINE __attribute__((noinline))
+#else
+#define KAFKA_LIKELY(x) (x)
+#define KAFKA_UNLIKELY(x) (x)
+#define KAFKA_COLD
+#define KAFKA_NOINLINE
+#endif
+
 
 #endif //KAFKA_BASICDEFINE_H
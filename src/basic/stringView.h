@@ -0,0 +1,58 @@
+/**
+ * @file stringView.h
+ * @brief 不持有内存的字符串引用
+ * @author ziv
+ * @email
+ * @date 22-11-10.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_STRINGVIEW_H
+#define KAFKA_STRINGVIEW_H
+
+#include <string.h>
+#include <string>
+#include <ostream>
+#include "basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 字符串引用，只记录指针和长度，不拷贝内容
+ */
+class StringView {
+public:
+    StringView() : m_data(""), m_size(0) {}
+
+    StringView(const char *data, size_t size) : m_data(data), m_size(size) {}
+
+    StringView(const char *str) : m_data(str), m_size(strlen(str)) {}
+
+    StringView(const std::string &str) : m_data(str.data()), m_size(str.size()) {}
+
+    const char* data() const {return m_data;}
+
+    size_t size() const {return m_size;}
+
+    bool empty() const {return m_size == 0;}
+
+    std::string toString() const {return std::string(m_data, m_size);}
+
+    bool operator==(const StringView &rhs) const {
+        return m_size == rhs.m_size && memcmp(m_data, rhs.m_data, m_size) == 0;
+    }
+
+    bool operator!=(const StringView &rhs) const {return !(*this == rhs);}
+
+private:
+    const char *m_data;
+    size_t m_size;
+};
+
+inline std::ostream& operator<<(std::ostream &os, const StringView &view) {
+    return os.write(view.data(), view.size());
+}
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_STRINGVIEW_H
@@ -0,0 +1,189 @@
+/**
+ * @file asyncLogWriter.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-3.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "asyncLogWriter.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+KAFKA_NAMESPACE_BEGIN
+
+//待写入缓冲区超过该数量时认为写入速度跟不上，丢弃多余的日志
+static const size_t kMaxPendingBuffers = 25;
+
+AsyncLogWriter::AsyncLogWriter(const std::string &filename, int flushInterval)
+    : m_filename(filename),
+      m_flushInterval(flushInterval),
+      m_running(false),
+      m_reopen(false),
+      m_currentBuffer(new Buffer),
+      m_nextBuffer(new Buffer) {
+    m_buffers.reserve(16);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    if (m_running) {
+        stop();
+    }
+}
+
+void AsyncLogWriter::append(const char *data, size_t len) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_currentBuffer->append(data, len)) {
+        return;
+    }
+
+    if (len > kLargeBuffer) {
+        //超过一整块缓冲区的日志依次填满多块缓冲区，后台线程按顺序写入
+        while (len > 0) {
+            size_t n = std::min(len, m_currentBuffer->avail());
+            m_currentBuffer->append(data, n);
+            data += n;
+            len -= n;
+            if (len > 0) {
+                switchBuffer();
+            }
+        }
+    }
+    else {
+        switchBuffer();
+        m_currentBuffer->append(data, len);
+    }
+    m_cond.notify_one();
+}
+
+void AsyncLogWriter::switchBuffer() {
+    m_buffers.push_back(std::move(m_currentBuffer));
+    if (m_nextBuffer) {
+        m_currentBuffer = std::move(m_nextBuffer);
+    }
+    else {
+        //写入太慢，两块缓冲区都已用完
+        m_currentBuffer.reset(new Buffer);
+    }
+}
+
+void AsyncLogWriter::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&AsyncLogWriter::threadFunc, this);
+}
+
+void AsyncLogWriter::stop() {
+    {
+        //在锁内修改，避免后台线程检查后、等待前错过通知
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cond.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool AsyncLogWriter::openFile() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        std::cout << "AsyncLogWriter open file failed, filename=" << m_filename
+                  << ", errno=" << errno << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void AsyncLogWriter::writeFile(const char *data, size_t len) {
+    if (m_fd < 0) {
+        return;
+    }
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void AsyncLogWriter::threadFunc() {
+    BufferPtr newBuffer1(new Buffer);
+    BufferPtr newBuffer2(new Buffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+    openFile();
+
+    bool running = true;
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            running = m_running;
+            if (running && m_buffers.empty()) {
+                m_cond.wait_for(lock, std::chrono::seconds(m_flushInterval));
+            }
+            m_buffers.push_back(std::move(m_currentBuffer));
+            m_currentBuffer = std::move(newBuffer1);
+            buffersToWrite.swap(m_buffers);
+            if (!m_nextBuffer) {
+                m_nextBuffer = std::move(newBuffer2);
+            }
+        }
+
+        if (buffersToWrite.size() > kMaxPendingBuffers) {
+            char buf[256];
+            int n = snprintf(buf, sizeof(buf), "Dropped log messages, %zu larger buffers\n",
+                             buffersToWrite.size() - 2);
+            writeFile(buf, n);
+            buffersToWrite.resize(2);
+        }
+
+        if (m_reopen.exchange(false)) {
+            openFile();
+        }
+
+        for (auto &buffer : buffersToWrite) {
+            writeFile(buffer->data(), buffer->length());
+        }
+
+        if (buffersToWrite.size() > 2) {
+            buffersToWrite.resize(2);
+        }
+
+        //回收已写入的缓冲区
+        if (!newBuffer1) {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2) {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+        buffersToWrite.clear();
+    }
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+KAFKA_NAMESPACE_END
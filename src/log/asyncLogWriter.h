@@ -0,0 +1,113 @@
+/**
+ * @file asyncLogWriter.h
+ * @brief 双缓冲异步文件写入
+ * @author ziv
+ * @email
+ * @date 22-11-3.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_ASYNCLOGWRITER_H
+#define KAFKA_ASYNCLOGWRITER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include "logBuffer.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 异步日志写入器
+ * @details 生产者线程只把格式化好的字节追加到前端缓冲区，
+ *          后台线程交换前后端缓冲区后整块写入文件，文件IO不在调用线程上发生
+ */
+class AsyncLogWriter : noncopyable {
+public:
+    typedef std::shared_ptr<AsyncLogWriter> AsyncLogWriterPtr;
+
+    /**
+     * @brief
+     * @param filename 文件名
+     * @param flushInterval 后台线程最长等待秒数，超时后即使缓冲区未满也写入
+     */
+    explicit AsyncLogWriter(const std::string &filename, int flushInterval = 3);
+
+    ~AsyncLogWriter();
+
+    /**
+     * @brief 追加数据到前端缓冲区，超过一块缓冲区大小的数据分块写入
+     * @param data 数据
+     * @param len 长度
+     */
+    void append(const char *data, size_t len);
+
+    /**
+     * @brief 启动后台线程
+     */
+    void start();
+
+    /**
+     * @brief 停止后台线程，已缓冲的数据全部写入文件
+     */
+    void stop();
+
+    /**
+     * @brief 通知后台线程重新打开文件
+     */
+    void reopen() {m_reopen = true;}
+
+    const std::string& getFilename() const {return m_filename;}
+
+private:
+    typedef FixedBuffer<kLargeBuffer> Buffer;
+    typedef std::unique_ptr<Buffer> BufferPtr;
+    typedef std::vector<BufferPtr> BufferVector;
+
+    /**
+     * @brief 当前缓冲区交给后台线程，换上预备缓冲区，需持有m_mutex
+     */
+    void switchBuffer();
+
+    /**
+     * @brief 后台线程
+     */
+    void threadFunc();
+
+    /**
+     * @brief 打开文件，仅在后台线程调用
+     */
+    bool openFile();
+
+    /**
+     * @brief 写入文件，仅在后台线程调用
+     */
+    void writeFile(const char *data, size_t len);
+
+private:
+    std::string m_filename;
+    //写入间隔(秒)
+    const int m_flushInterval;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_reopen;
+    int m_fd = -1;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    //当前缓冲区
+    BufferPtr m_currentBuffer;
+    //预备缓冲区
+    BufferPtr m_nextBuffer;
+    //待写入的缓冲区
+    BufferVector m_buffers;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_ASYNCLOGWRITER_H
@@ -0,0 +1,350 @@
+/**
+ * @file binaryLog.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-12.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "binaryLog.h"
+#include "asyncLogWriter.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+KAFKA_NAMESPACE_BEGIN
+
+static void appendString(LogBuffer &buf, const char *str, size_t len) {
+    uint32_t size = static_cast<uint32_t>(len);
+    buf.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    buf.append(str, len);
+}
+
+template<class T>
+static void appendValue(LogBuffer &buf, T value) {
+    buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void BinaryLog::BeginRecord(LogBuffer &buf, uint32_t id, LogLevel::Level level, uint32_t elapse,
+                            uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp, const char *thread_name) {
+    appendValue<uint8_t>(buf, kRecordFrame);
+    appendValue<uint32_t>(buf, 0);
+    appendValue<uint32_t>(buf, id);
+    appendValue<uint8_t>(buf, static_cast<uint8_t>(level));
+    appendValue<uint64_t>(buf, timestamp);
+    appendValue<uint32_t>(buf, elapse);
+    appendValue<uint32_t>(buf, thread_id);
+    appendValue<uint32_t>(buf, fiber_id);
+    appendString(buf, thread_name, strlen(thread_name));
+}
+
+void BinaryLog::EndFrame(LogBuffer &buf) {
+    uint32_t len = static_cast<uint32_t>(buf.size() - sizeof(uint8_t) - sizeof(uint32_t));
+    memcpy(const_cast<char*>(buf.data()) + sizeof(uint8_t), &len, sizeof(len));
+}
+
+/**
+ * @brief 调用点描述帧
+ */
+static void appendSiteFrame(LogBuffer &buf, uint32_t id, int32_t line, const char *file,
+                            const char *format, const char *types) {
+    appendValue<uint8_t>(buf, BinaryLog::kSiteFrame);
+    appendValue<uint32_t>(buf, 0);
+    appendValue<uint32_t>(buf, id);
+    appendValue<int32_t>(buf, line);
+    appendString(buf, file, strlen(file));
+    appendString(buf, format, strlen(format));
+    appendString(buf, types, strlen(types));
+    BinaryLog::EndFrame(buf);
+}
+
+void BinaryLog::LogSuppressed(BinaryLogWriter &writer, LogLevel::Level level, LogSite &site, uint64_t count) {
+    uint32_t id = site.getId();
+    LogBuffer frame;
+    LogThreadContext &context = LogThreadContext::Current();
+    uint64_t now = LogClock::Now();
+    BeginRecord(frame, id | kSuppressedSite, level, LogThreadContext::Elapse(now), context.getThreadId(),
+                context.getFiberId(), now, context.getThreadName().c_str());
+    BinaryArg<uint64_t>::encode(frame, count);
+    EndFrame(frame);
+    writer.writeSuppressed(site, id, frame.data(), frame.size());
+}
+
+static void appendFormat(std::string &out, const char *fmt, ...) {
+    char buf[256];
+    va_list al;
+    va_start(al, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, al);
+    va_end(al);
+    if (len < 0) {
+        return;
+    }
+    if (static_cast<size_t>(len) < sizeof(buf)) {
+        out.append(buf, len);
+        return;
+    }
+    std::string tmp(len + 1, '\0');
+    va_start(al, fmt);
+    vsnprintf(&tmp[0], tmp.size(), fmt, al);
+    va_end(al);
+    out.append(tmp.data(), len);
+}
+
+namespace {
+
+/**
+ * @brief 按类型依次读取编码的参数
+ */
+class BinaryArgReader {
+public:
+    BinaryArgReader(const char *types, const char *args, size_t len)
+        : m_types(types), m_cur(args), m_end(args + len) {}
+
+    /**
+     * @brief 读取下一个参数
+     * @param type 参数类型
+     * @return 是否还有参数
+     */
+    bool next(char &type) {
+        if (!*m_types) {
+            return false;
+        }
+        type = *m_types++;
+        size_t need = type == 's' ? sizeof(uint32_t) : sizeof(uint64_t);
+        if (static_cast<size_t>(m_end - m_cur) < need) {
+            m_error = true;
+            return false;
+        }
+        if (type == 's') {
+            uint32_t size;
+            memcpy(&size, m_cur, sizeof(size));
+            m_cur += sizeof(size);
+            if (static_cast<size_t>(m_end - m_cur) < size) {
+                m_error = true;
+                return false;
+            }
+            m_str.assign(m_cur, size);
+            m_cur += size;
+        }
+        else {
+            memcpy(&m_raw, m_cur, sizeof(m_raw));
+            m_cur += sizeof(m_raw);
+        }
+        return true;
+    }
+
+    int64_t asInt(char type) const {
+        if (type == 'd') {
+            double v;
+            memcpy(&v, &m_raw, sizeof(v));
+            return static_cast<int64_t>(v);
+        }
+        return static_cast<int64_t>(m_raw);
+    }
+
+    double asDouble(char type) const {
+        if (type == 'd') {
+            double v;
+            memcpy(&v, &m_raw, sizeof(v));
+            return v;
+        }
+        return type == 'i' ? static_cast<double>(static_cast<int64_t>(m_raw)) : static_cast<double>(m_raw);
+    }
+
+    const std::string& asString() const {return m_str;}
+
+    bool isError() const {return m_error;}
+
+private:
+    const char *m_types;
+    const char *m_cur;
+    const char *m_end;
+    uint64_t m_raw = 0;
+    std::string m_str;
+    bool m_error = false;
+};
+
+}
+
+bool BinaryLog::Render(const char *format, const char *types, const char *args, size_t len, std::string &out) {
+    BinaryArgReader reader(types, args, len);
+    char type = 0;
+    for (const char *p = format; *p;) {
+        if (*p != '%') {
+            out.append(1, *p++);
+            continue;
+        }
+        if (p[1] == '%') {
+            out.append(1, '%');
+            p += 2;
+            continue;
+        }
+
+        //%[flags][width][.precision][length]conversion
+        std::string spec("%");
+        ++p;
+        while (*p && strchr("-+ #0'", *p)) {
+            spec.append(1, *p++);
+        }
+        if (*p == '*') {
+            if (!reader.next(type)) {
+                return false;
+            }
+            spec.append(std::to_string(reader.asInt(type)));
+            ++p;
+        }
+        while (*p >= '0' && *p <= '9') {
+            spec.append(1, *p++);
+        }
+        if (*p == '.') {
+            spec.append(1, *p++);
+            if (*p == '*') {
+                if (!reader.next(type)) {
+                    return false;
+                }
+                spec.append(std::to_string(reader.asInt(type)));
+                ++p;
+            }
+            while (*p >= '0' && *p <= '9') {
+                spec.append(1, *p++);
+            }
+        }
+        //整数统一按64位编码，h、hh按vsnprintf的规则截断
+        bool longDouble = false;
+        int shorts = 0;
+        while (*p && strchr("hlLqjzt", *p)) {
+            longDouble = longDouble || *p == 'L';
+            shorts += *p == 'h';
+            ++p;
+        }
+
+        char conv = *p;
+        if (!conv) {
+            break;
+        }
+        ++p;
+        if (conv == 'n') {
+            reader.next(type);
+            continue;
+        }
+        if (!reader.next(type)) {
+            return false;
+        }
+        switch (conv) {
+            case 'd':
+            case 'i': {
+                long long value = reader.asInt(type);
+                if (shorts == 1) {
+                    value = static_cast<short>(value);
+                }
+                else if (shorts > 1) {
+                    value = static_cast<signed char>(value);
+                }
+                appendFormat(out, (spec + "lld").c_str(), value);
+                break;
+            }
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                unsigned long long value = static_cast<unsigned long long>(reader.asInt(type));
+                if (shorts == 1) {
+                    value = static_cast<unsigned short>(value);
+                }
+                else if (shorts > 1) {
+                    value = static_cast<unsigned char>(value);
+                }
+                appendFormat(out, (spec + "ll" + conv).c_str(), value);
+                break;
+            }
+            case 'c':
+                appendFormat(out, (spec + "c").c_str(), static_cast<int>(reader.asInt(type)));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if (longDouble) {
+                    appendFormat(out, (spec + "L" + conv).c_str(), static_cast<long double>(reader.asDouble(type)));
+                }
+                else {
+                    appendFormat(out, (spec + conv).c_str(), reader.asDouble(type));
+                }
+                break;
+            case 's':
+                appendFormat(out, (spec + "s").c_str(), type == 's' ? reader.asString().c_str() : "(?)");
+                break;
+            case 'p':
+                appendFormat(out, (spec + "p").c_str(), reinterpret_cast<void*>(static_cast<uintptr_t>(reader.asInt(type))));
+                break;
+            default:
+                out.append(spec).append(1, conv);
+                break;
+        }
+    }
+    return !reader.isError();
+}
+
+BinaryLogWriter::BinaryLogWriter(const std::string &filename, const std::string &loggerName)
+    : m_filename(filename), m_writer(new AsyncLogWriter(filename)) {
+    static std::atomic<uint32_t> s_nextId(1);
+    m_id = s_nextId.fetch_add(1, std::memory_order_relaxed);
+    m_writer->start();
+    LogBuffer header;
+    header.append(BinaryLog::Magic(), strlen(BinaryLog::Magic()));
+    appendValue<uint32_t>(header, BinaryLog::kVersion);
+    appendValue<int64_t>(header, LogClock::WallOffset());
+    appendString(header, loggerName.data(), loggerName.size());
+    m_writer->append(header.data(), header.size());
+}
+
+BinaryLogWriter::~BinaryLogWriter() {
+    m_writer->stop();
+}
+
+void BinaryLogWriter::write(LogSite &site, uint32_t id, const char *frame, size_t len) {
+    if (KAFKA_UNLIKELY(site.getBinaryWriter() != m_id)) {
+        writeSite(site, id);
+    }
+    m_writer->append(frame, len);
+    if (LogFlightRecorder::IsEnabled()) {
+        LogFlightRecorder::RecordFrame(site, frame, len);
+    }
+}
+
+void BinaryLogWriter::writeSite(LogSite &site, uint32_t id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id >= m_sites.size()) {
+        m_sites.resize(id + 1, false);
+    }
+    if (!m_sites[id]) {
+        LogBuffer buf;
+        appendSiteFrame(buf, id, site.getLine(), site.getFile(), site.getFormat(), site.getArgTypes());
+        m_writer->append(buf.data(), buf.size());
+        m_sites[id] = true;
+    }
+    //描述已写入队列后再标记，其他线程看到标记时写入的记录一定排在描述之后
+    site.setBinaryWriter(m_id);
+}
+
+void BinaryLogWriter::writeSuppressed(LogSite &site, uint32_t id, const char *frame, size_t len) {
+    //汇总记录很少出现，在锁内写入，保证排在描述之后
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id >= m_suppressedSites.size()) {
+        m_suppressedSites.resize(id + 1, false);
+    }
+    if (!m_suppressedSites[id]) {
+        LogBuffer buf;
+        appendSiteFrame(buf, id | BinaryLog::kSuppressedSite, site.getLine(), site.getFile(),
+                        "suppressed %llu records since last output", "u");
+        m_writer->append(buf.data(), buf.size());
+        m_suppressedSites[id] = true;
+    }
+    m_writer->append(frame, len);
+}
+
+KAFKA_NAMESPACE_END
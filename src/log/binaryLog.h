@@ -0,0 +1,282 @@
+/**
+ * @file binaryLog.h
+ * @brief 延迟格式化的二进制日志
+ * @author ziv
+ * @email
+ * @date 22-11-12.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_BINARYLOG_H
+#define KAFKA_BINARYLOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include "log.h"
+#include "logBuffer.h"
+#include "logContext.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+class AsyncLogWriter;
+
+/**
+ * @brief 参数的二进制编码，kType为参数类型
+ * @details i:有符号整数(int64) u:无符号整数(uint64) d:浮点数(double) s:字符串(uint32长度+内容) p:指针(uint64)。
+ *          Buffer为 LogBuffer 或其他提供append(data, len)的缓冲区
+ */
+template<class T, class Enable = void>
+struct BinaryArg;
+
+template<class T>
+struct BinaryArg<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+    static const char kType = 'i';
+    template<class Buffer>
+    static void encode(Buffer &buf, T v) {
+        int64_t value = v;
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+};
+
+template<class T>
+struct BinaryArg<T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type> {
+    static const char kType = 'u';
+    template<class Buffer>
+    static void encode(Buffer &buf, T v) {
+        uint64_t value = v;
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+};
+
+template<class T>
+struct BinaryArg<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static const char kType = 'i';
+    template<class Buffer>
+    static void encode(Buffer &buf, T v) {
+        int64_t value = static_cast<int64_t>(v);
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+};
+
+template<class T>
+struct BinaryArg<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static const char kType = 'd';
+    template<class Buffer>
+    static void encode(Buffer &buf, T v) {
+        double value = static_cast<double>(v);
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+};
+
+/**
+ * @brief 字符串参数拷贝内容
+ */
+struct BinaryStringArg {
+    static const char kType = 's';
+    template<class Buffer>
+    static void encode(Buffer &buf, const char *str, size_t len) {
+        uint32_t size = static_cast<uint32_t>(len);
+        buf.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        buf.append(str, len);
+    }
+    template<class Buffer>
+    static void encode(Buffer &buf, const char *str) {
+        if (str) {
+            encode(buf, str, strlen(str));
+        }
+        else {
+            encode(buf, "(null)", 6);
+        }
+    }
+};
+
+template<>
+struct BinaryArg<const char*> : public BinaryStringArg {};
+
+template<>
+struct BinaryArg<char*> : public BinaryStringArg {};
+
+template<size_t N>
+struct BinaryArg<char[N]> : public BinaryStringArg {};
+
+template<>
+struct BinaryArg<std::string> : public BinaryStringArg {
+    template<class Buffer>
+    static void encode(Buffer &buf, const std::string &str) {
+        BinaryStringArg::encode(buf, str.data(), str.size());
+    }
+};
+
+template<class T>
+struct BinaryArg<T*, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+    static const char kType = 'p';
+    template<class Buffer>
+    static void encode(Buffer &buf, const T *p) {
+        uint64_t value = reinterpret_cast<uintptr_t>(p);
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+};
+
+/**
+ * @brief 二进制日志写入器，每个Logger一个，文件IO由AsyncLogWriter在后台完成
+ * @details 文件格式(本机字节序):
+ *          文件头: "KAFKABL1" uint32版本 int64墙上时间差值 str日志器名称
+ *          之后为若干帧: uint8类型 uint32长度 内容
+ *          'S'调用点: uint32 id, int32行号, str文件名, str格式, str参数类型
+ *          'R'记录: uint32 id, uint8级别, uint64时间戳, uint32 elapse,
+ *                   uint32线程id, uint32协程id, str线程名称, 参数
+ *          str为uint32长度+内容。时间戳为 LogClock::Now()，加上文件头的差值为墙上时间(纳秒)，
+ *          由解码工具换算。版本1的文件头没有差值，记录中为uint64秒和uint32纳秒
+ */
+class BinaryLogWriter : noncopyable {
+public:
+    typedef std::shared_ptr<BinaryLogWriter> BinaryLogWriterPtr;
+
+    /**
+     * @brief
+     * @param filename 文件名
+     * @param loggerName 日志器名称
+     */
+    BinaryLogWriter(const std::string &filename, const std::string &loggerName);
+
+    ~BinaryLogWriter();
+
+    /**
+     * @brief 写入一条编码好的记录帧，调用点第一次出现时先写入其描述
+     * @details 调用点记录最近写入过其描述的写入器编号，相同时只加AsyncLogWriter的锁
+     * @param site 调用点
+     * @param id 调用点id
+     * @param frame 记录帧
+     * @param len 长度
+     */
+    void write(LogSite &site, uint32_t id, const char *frame, size_t len);
+
+    /**
+     * @brief 写入调用点被限流或采样跳过数量的汇总记录，第一次出现时先写入汇总的描述
+     * @param site 调用点
+     * @param id 调用点id，汇总记录的id为id | BinaryLog::kSuppressedSite
+     * @param frame 记录帧
+     * @param len 长度
+     */
+    KAFKA_COLD void writeSuppressed(LogSite &site, uint32_t id, const char *frame, size_t len);
+
+    const std::string& getFilename() const {return m_filename;}
+
+private:
+    /**
+     * @brief 调用点第一次出现时写入其描述
+     */
+    KAFKA_COLD void writeSite(LogSite &site, uint32_t id);
+
+    std::string m_filename;
+    //写入器编号，从1开始，不随地址复用
+    uint32_t m_id;
+    //保护m_sites
+    std::mutex m_mutex;
+    //已写入描述的调用点
+    std::vector<bool> m_sites;
+    //已写入汇总描述的调用点
+    std::vector<bool> m_suppressedSites;
+    std::unique_ptr<AsyncLogWriter> m_writer;
+};
+
+/**
+ * @brief 二进制日志
+ */
+class BinaryLog {
+public:
+    //文件头标识
+    static const char* Magic() {return "KAFKABL1";}
+    static const uint32_t kVersion = 2;
+    //帧类型
+    static const uint8_t kSiteFrame = 'S';
+    static const uint8_t kRecordFrame = 'R';
+    //限流或采样跳过数量的汇总记录使用的调用点id标记
+    static const uint32_t kSuppressedSite = 0x40000000u;
+
+    /**
+     * @brief 供KAFKA_LOG_FMT_*使用，日志器设置了二进制日志文件时写入二进制记录，否则按fmt格式化输出
+     * @details 写入器只读取一次，之后使用该副本，与 Logger::setBinaryLogFile 并发时不会访问已释放的写入器
+     */
+    template<class... Args>
+    KAFKA_COLD static void Format(const std::shared_ptr<Logger> &logger, LogLevel::Level level, LogSite &site,
+                                  const char *fmt, const Args&... args) {
+        std::shared_ptr<BinaryLogWriter> writer = logger->getBinaryWriter();
+        if (writer) {
+            Log(*writer, level, site, args...);
+        }
+        else {
+            LogEventWrap::Format(logger, level, site, fmt, args...);
+        }
+    }
+
+    /**
+     * @brief 记录一条日志，只编码调用点id和原始参数，不做格式化，线程信息取自 LogThreadContext
+     */
+    template<class... Args>
+    static void Log(BinaryLogWriter &writer, LogLevel::Level level, LogSite &site, const Args&... args) {
+        static const char s_types[] = {BinaryArg<Args>::kType..., '\0'};
+        if (KAFKA_UNLIKELY(!site.getArgTypes())) {
+            site.setArgTypes(s_types);
+        }
+        uint32_t id = site.getId();
+        uint64_t suppressed = site.takeSuppressed();
+        if (KAFKA_UNLIKELY(suppressed)) {
+            //先补一条限流或采样跳过的数量
+            LogSuppressed(writer, level, site, suppressed);
+        }
+
+        static thread_local LogBuffer t_frame;
+        t_frame.clear();
+        LogThreadContext &context = LogThreadContext::Current();
+        uint64_t now = LogClock::Now();
+        BeginRecord(t_frame, id, level, LogThreadContext::Elapse(now), context.getThreadId(), context.getFiberId(),
+                    now, context.getThreadName().c_str());
+        int dummy[] = {0, (BinaryArg<Args>::encode(t_frame, args), 0)...};
+        (void)dummy;
+        EndFrame(t_frame);
+        writer.write(site, id, t_frame.data(), t_frame.size());
+    }
+
+    /**
+     * @brief 记录调用点被限流或采样跳过的数量，与文本输出的 "suppressed N records since last output" 一致
+     */
+    KAFKA_COLD static void LogSuppressed(BinaryLogWriter &writer, LogLevel::Level level, LogSite &site,
+                                         uint64_t count);
+
+    /**
+     * @brief 按格式字符串和参数类型把编码的参数还原为文本，与vsnprintf的结果一致
+     * @param format 格式字符串
+     * @param types 参数类型
+     * @param args 参数
+     * @param len 参数长度
+     * @param out 输出
+     * @return 参数是否完整
+     */
+    static bool Render(const char *format, const char *types, const char *args, size_t len, std::string &out);
+
+    /**
+     * @brief 写入帧头和记录的固定字段
+     */
+    static void BeginRecord(LogBuffer &buf, uint32_t id, LogLevel::Level level, uint32_t elapse,
+                            uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp, const char *thread_name);
+
+    /**
+     * @brief 回填帧长度
+     */
+    static void EndFrame(LogBuffer &buf);
+};
+
+KAFKA_NAMESPACE_END
+
+#include "logFlightRecorder.h"
+
+#endif //KAFKA_BINARYLOG_H
@@ -0,0 +1,144 @@
+/**
+ * @file dateTimeFormat.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-8.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "dateTimeFormat.h"
+#include <time.h>
+#include <atomic>
+#include <vector>
+
+KAFKA_NAMESPACE_BEGIN
+
+//strftime输出的最大长度
+static const size_t kDateTimeBufferSize = 1000;
+//每个线程缓存的格式数量
+static const size_t kCacheSize = 8;
+
+namespace {
+
+/**
+ * @brief 一个格式在当前线程的缓存
+ */
+struct DateTimeCacheEntry {
+    uint64_t id = 0;
+    int64_t sec = -1;
+    //最近一次使用的序号，替换最久未使用的缓存
+    uint64_t used = 0;
+    //当前秒的渲染结果
+    std::string text;
+    //亚秒字段的位置和位数
+    std::vector<std::pair<uint32_t, uint32_t>> marks;
+};
+
+/**
+ * @brief 当前线程的缓存，按格式id全相联查找
+ */
+struct DateTimeCache {
+    DateTimeCacheEntry entries[kCacheSize];
+    uint64_t tick = 0;
+
+    DateTimeCacheEntry& get(uint64_t id) {
+        DateTimeCacheEntry *victim = &entries[0];
+        for (auto &item : entries) {
+            if (item.id == id) {
+                victim = &item;
+                break;
+            }
+            if (item.used < victim->used) {
+                victim = &item;
+            }
+        }
+        victim->used = ++tick;
+        return *victim;
+    }
+};
+
+std::atomic<uint64_t> s_nextId(1);
+
+}
+
+DateTimeFormat::DateTimeFormat(const std::string &format)
+    : m_format(format.empty() ? "%Y-%m-%d %H:%M:%S" : format),
+      m_id(s_nextId.fetch_add(1, std::memory_order_relaxed)) {
+    Part part;
+    part.digits = 0;
+    for (size_t i = 0; i < m_format.size(); ++i) {
+        if (m_format[i] != '%' || i + 1 >= m_format.size()) {
+            part.strftime.append(1, m_format[i]);
+            continue;
+        }
+        char c = m_format[i + 1];
+        uint32_t digits = 0;
+        if (c == '%') {
+            part.strftime.append("%%");
+            ++i;
+        }
+        else if (c == 'N') {
+            digits = 9;
+            ++i;
+        }
+        else if ((c == '3' || c == '6' || c == '9') && i + 2 < m_format.size() && m_format[i + 2] == 'N') {
+            digits = c - '0';
+            i += 2;
+        }
+        else {
+            part.strftime.append(1, '%');
+        }
+        //亚秒字段结束当前段
+        if (digits) {
+            part.digits = digits;
+            m_parts.push_back(part);
+            part.strftime.clear();
+            part.digits = 0;
+        }
+    }
+    if (!part.strftime.empty() || m_parts.empty()) {
+        m_parts.push_back(part);
+    }
+}
+
+void DateTimeFormat::format(LogBuffer &buf, uint64_t sec, uint32_t nsec) const {
+    static thread_local DateTimeCache t_cache;
+    DateTimeCacheEntry &entry = t_cache.get(m_id);
+    if (entry.id != m_id || entry.sec != static_cast<int64_t>(sec)) {
+        struct tm tm;
+        time_t time = static_cast<time_t>(sec);
+        localtime_r(&time, &tm);
+        entry.id = m_id;
+        entry.sec = static_cast<int64_t>(sec);
+        entry.text.clear();
+        entry.marks.clear();
+        char tmp[kDateTimeBufferSize];
+        for (auto &part : m_parts) {
+            if (!part.strftime.empty()) {
+                entry.text.append(tmp, strftime(tmp, sizeof(tmp), part.strftime.c_str(), &tm));
+            }
+            if (part.digits) {
+                entry.marks.push_back(std::make_pair(static_cast<uint32_t>(entry.text.size()), part.digits));
+                entry.text.append(part.digits, '0');
+            }
+        }
+    }
+
+    char *p = buf.reserve(entry.text.size());
+    memcpy(p, entry.text.data(), entry.text.size());
+    for (auto &mark : entry.marks) {
+        //按位数截断纳秒，不足补0
+        uint32_t value = nsec;
+        for (uint32_t i = mark.second; i < 9; ++i) {
+            value /= 10;
+        }
+        for (uint32_t i = mark.second; i > 0; --i) {
+            p[mark.first + i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+    buf.commit(entry.text.size());
+}
+
+KAFKA_NAMESPACE_END
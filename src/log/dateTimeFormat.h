@@ -0,0 +1,75 @@
+/**
+ * @file dateTimeFormat.h
+ * @brief 带缓存的时间格式化
+ * @author ziv
+ * @email
+ * @date 22-11-8.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_DATETIMEFORMAT_H
+#define KAFKA_DATETIMEFORMAT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "logBuffer.h"
+#include "../basic/basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 时间格式化
+ * @details 格式与strftime相同，另外支持亚秒字段 %3N(毫秒) %6N(微秒) %9N/%N(纳秒)。
+ *          每个线程按格式缓存当前秒的渲染结果，只有秒数变化时才调用localtime_r和strftime，
+ *          解析时按亚秒字段切分格式，亚秒字段在缓存结果的固定位置上直接写入数字
+ */
+class DateTimeFormat {
+public:
+    /**
+     * @brief
+     * @param format 时间格式，为空时使用 "%Y-%m-%d %H:%M:%S"
+     */
+    explicit DateTimeFormat(const std::string &format = "");
+
+    /**
+     * @brief 格式化时间追加到缓冲区
+     * @param buf 输出缓冲区
+     * @param sec 秒
+     * @param nsec 秒内的纳秒
+     */
+    void format(LogBuffer &buf, uint64_t sec, uint32_t nsec) const;
+
+    /**
+     * @brief 格式化时间追加到缓冲区
+     * @param buf 输出缓冲区
+     * @param wallTime 1970年以来的纳秒数
+     */
+    void format(LogBuffer &buf, uint64_t wallTime) const {
+        format(buf, wallTime / 1000000000, static_cast<uint32_t>(wallTime % 1000000000));
+    }
+
+    const std::string& getFormat() const {return m_format;}
+
+private:
+    /**
+     * @brief 按亚秒字段切分的一段格式，strftime格式后接一个亚秒字段
+     */
+    struct Part {
+        std::string strftime;
+        //亚秒字段的位数，为0时没有
+        uint32_t digits;
+    };
+
+private:
+    //原始格式
+    std::string m_format;
+    //解析时确定的各段及亚秒字段位数
+    std::vector<Part> m_parts;
+    //缓存键，每个实例唯一
+    uint64_t m_id;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_DATETIMEFORMAT_H
@@ -0,0 +1,197 @@
+/**
+ * @file jsonLogFormatter.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-19.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "jsonLogFormatter.h"
+#include <stdio.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define KAFKA_JSON_SIMD 1
+#endif
+
+KAFKA_NAMESPACE_BEGIN
+
+namespace {
+
+inline bool needsEscape(uint8_t c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/**
+ * @brief 第一个需要转义的字符的位置，没有时返回len
+ */
+size_t scanScalar(const char *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (needsEscape(static_cast<uint8_t>(data[i]))) {
+            return i;
+        }
+    }
+    return len;
+}
+
+#ifdef KAFKA_JSON_SIMD
+size_t scanSse2(const char *data, size_t len) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        //无符号比较 c <= 0x1f 等价于 min(c, 0x1f) == c
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scanScalar(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+size_t scanAvx2(const char *data, size_t len) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                      _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl), v));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scanSse2(data + i, len - i);
+}
+#endif
+
+typedef size_t (*ScanFunc)(const char *data, size_t len);
+
+ScanFunc selectScan() {
+#ifdef KAFKA_JSON_SIMD
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? scanAvx2 : scanSse2;
+#else
+    return scanScalar;
+#endif
+}
+
+void escapeChar(LogBuffer &buf, uint8_t c) {
+    static const char s_hex[] = "0123456789abcdef";
+    switch (c) {
+        case '"':
+            buf.append("\\\"", 2);
+            break;
+        case '\\':
+            buf.append("\\\\", 2);
+            break;
+        case '\n':
+            buf.append("\\n", 2);
+            break;
+        case '\r':
+            buf.append("\\r", 2);
+            break;
+        case '\t':
+            buf.append("\\t", 2);
+            break;
+        case '\b':
+            buf.append("\\b", 2);
+            break;
+        case '\f':
+            buf.append("\\f", 2);
+            break;
+        default: {
+            char tmp[6] = {'\\', 'u', '0', '0', s_hex[c >> 4], s_hex[c & 0xf]};
+            buf.append(tmp, sizeof(tmp));
+            break;
+        }
+    }
+}
+
+void appendString(LogBuffer &buf, const char *data, size_t len) {
+    buf.append('"');
+    JsonLogFormatter::Escape(buf, data, len);
+    buf.append('"');
+}
+
+}
+
+JsonLogFormatter::JsonLogFormatter(const std::string &timeFormat) : m_dateFormat(timeFormat) {
+    m_pattern = "json";
+}
+
+void JsonLogFormatter::format(LogBuffer &buf, const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                              const LogEvent::LogEventPtr &event) {
+    buf.append("{\"time\":\"", 9);
+    m_dateFormat.format(buf, event->getWallTime());
+    buf.append("\",\"level\":\"", 11);
+    buf.append(LogLevel::toString(level));
+    buf.append("\",\"logger\":", 11);
+    appendString(buf, logger->getName().data(), logger->getName().size());
+    buf.append(",\"thread_id\":", 13);
+    buf.appendUInt(event->getThreadId());
+    buf.append(",\"thread_name\":", 15);
+    appendString(buf, event->getThreadName().data(), event->getThreadName().size());
+    buf.append(",\"fiber_id\":", 12);
+    buf.appendUInt(event->getFiberId());
+    buf.append(",\"elapse\":", 10);
+    buf.appendUInt(event->getElapse());
+    buf.append(",\"file\":", 8);
+    appendString(buf, event->getFile(), strlen(event->getFile()));
+    buf.append(",\"line\":", 8);
+    buf.appendInt(event->getLine());
+    buf.append(",\"message\":", 11);
+    StringView content = event->getContent();
+    appendString(buf, content.data(), content.size());
+
+    const LogFields &fields = event->getFields();
+    for (size_t i = 0; i < fields.size(); ++i) {
+        LogField field = fields.get(i);
+        buf.append(',');
+        appendString(buf, field.getKey().data(), field.getKey().size());
+        buf.append(':');
+        switch (field.getType()) {
+            case LogField::DOUBLE: {
+                double v = field.getValue().d;
+                if (!isfinite(v)) {
+                    buf.append("null", 4);
+                    break;
+                }
+                char *p = buf.reserve(32);
+                buf.commit(snprintf(p, 32, "%.17g", v));
+                break;
+            }
+            case LogField::STRING:
+                appendString(buf, field.getString().data(), field.getString().size());
+                break;
+            default:
+                field.appendValue(buf);
+                break;
+        }
+    }
+    buf.append("}\n", 2);
+}
+
+void JsonLogFormatter::Escape(LogBuffer &buf, const char *data, size_t len) {
+    static const ScanFunc s_scan = selectScan();
+    while (len) {
+        size_t n = s_scan(data, len);
+        buf.append(data, n);
+        if (n == len) {
+            break;
+        }
+        escapeChar(buf, static_cast<uint8_t>(data[n]));
+        data += n + 1;
+        len -= n + 1;
+    }
+}
+
+KAFKA_NAMESPACE_END
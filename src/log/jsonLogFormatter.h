@@ -0,0 +1,54 @@
+/**
+ * @file jsonLogFormatter.h
+ * @brief JSON格式的日志格式器
+ * @author ziv
+ * @email
+ * @date 22-11-19.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_JSONLOGFORMATTER_H
+#define KAFKA_JSONLOGFORMATTER_H
+
+#include <string>
+#include "log.h"
+#include "dateTimeFormat.h"
+#include "../basic/basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 每条日志输出为一行JSON对象
+ * @details {"time":"...","level":"INFO","logger":"root","thread_id":1,"thread_name":"main","fiber_id":2,
+ *           "elapse":0,"file":"...","line":1,"message":"...", 键值字段...}
+ *          键值字段按类型输出为数字、布尔值或字符串，非有限的浮点数输出为null。
+ *          字符串转义按16/32字节批量查找需要转义的字符(SSE2/AVX2，运行时选择)，其余部分整段拷贝
+ */
+class JsonLogFormatter : public LogFormatter {
+public:
+    typedef std::shared_ptr<JsonLogFormatter> JsonLogFormatterPtr;
+
+    /**
+     * @brief
+     * @param timeFormat time字段的格式，同 %d{...}
+     */
+    explicit JsonLogFormatter(const std::string &timeFormat = "%Y-%m-%d %H:%M:%S");
+
+    void format(LogBuffer &buf, const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                const LogEvent::LogEventPtr &event) override;
+
+    /**
+     * @brief 按JSON字符串转义后写入，不含两端的引号
+     * @param buf
+     * @param data
+     * @param len
+     */
+    static void Escape(LogBuffer &buf, const char *data, size_t len);
+
+private:
+    DateTimeFormat m_dateFormat;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_JSONLOGFORMATTER_H
@@ -8,15 +8,35 @@
  */
 
 #include "log.h"
+#include "asyncLogWriter.h"
+#include "logDispatcher.h"
+#include "logStaging.h"
+#include "logDedup.h"
+#include "logContext.h"
+#include "logRcu.h"
 #include <functional>
 #include <map>
 #include <time.h>
 #include <string.h>
 #include <iostream>
 #include <memory>
+#include <chrono>
+#include <tuple>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
 
 KAFKA_NAMESPACE_BEGIN
 
+//每个线程最多缓存的空闲对象数
+static const size_t kMaxFreeItems = 256;
+//线程列表满时一次移入共享列表、线程列表空时一次从共享列表取回的对象数
+static const size_t kFreeBatch = kMaxFreeItems / 2;
+//共享列表最多缓存的空闲对象数
+static const size_t kMaxSharedFreeItems = 8192;
+
 const char * LogLevel::toString(LogLevel::Level level) {
     switch (level) {
 #define Func(name) \
@@ -56,10 +76,33 @@ LogLevel::Level LogLevel::fromString(const std::string &str) {
     return LogLevel::UNKNOWN;
 }
 
+const std::string LogEvent::s_emptyName;
+
 LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char *file, int32_t line, uint32_t elapse,
-                   uint32_t thread_id, uint32_t fiber_id, uint64_t time, const std::string &thread_name) :
+                   uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp, const std::string &thread_name) :
                    m_file(file), m_line(line), m_elapse(elapse), m_threadId(thread_id), m_fiberId(fiber_id),
-                   m_time(time), m_threadName(thread_name), m_logger(logger), m_level(level){}
+                   m_timestamp(timestamp), m_threadName(&LogThreadContext::Intern(thread_name)), m_logger(logger),
+                   m_level(level) {
+    m_ss.setFields(&m_fields);
+}
+
+void LogEvent::reset(std::shared_ptr<Logger> logger, LogLevel::Level level, const char *file, int32_t line,
+                     uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+                     const std::string &thread_name) {
+    m_file = file;
+    m_line = line;
+    m_site = nullptr;
+    m_elapse = elapse;
+    m_threadId = thread_id;
+    m_fiberId = fiber_id;
+    m_timestamp = timestamp;
+    m_wallTime = 0;
+    m_threadName = &thread_name;
+    m_ss.clear();
+    m_fields.clear();
+    m_logger = std::move(logger);
+    m_level = level;
+}
 
 void LogEvent::format(const char *fmt, ...) {
     va_list al;
@@ -69,180 +112,222 @@ void LogEvent::format(const char *fmt, ...) {
 }
 
 void LogEvent::format(const char *fmt, va_list al) {
-    char *buf = nullptr;
-    int len = vasprintf(&buf, fmt, al);
-    if (len != -1) {
-        m_ss << std::string(buf, len);
-        free(buf);
-    }
+    m_ss.vformat(fmt, al);
 }
 
-class MessageFormatItem : public LogFormatter::FormatItem {
-public:
-    MessageFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getContent();
-    }
-};
+namespace {
 
-class LevelFormatItem : public LogFormatter::FormatItem {
+/**
+ * @brief 线程本地空闲列表，线程退出时释放其中的对象
+ * @details 对象常在另一个线程释放(如AsyncLogDispatcher的消费线程)，释放线程的列表满时把一批对象移到共享列表，
+ *          申请线程的列表空时从共享列表取回一批，共享列表加锁，每kFreeBatch个对象才访问一次
+ * @tparam T 缓存的对象
+ * @tparam Tag 区分不同用途的列表
+ */
+template<class T, class Tag>
+class ThreadFreeList {
 public:
-    LevelFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << LogLevel::toString(level);
+    /**
+     * @brief 取出一个空闲对象，没有时返回nullptr
+     */
+    static T* Pop() {
+        List *list = GetList();
+        if (!list) {
+            return nullptr;
+        }
+        if (list->items.empty()) {
+            Shared &shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            size_t n = std::min(kFreeBatch, shared.items.size());
+            list->items.insert(list->items.end(), shared.items.end() - n, shared.items.end());
+            shared.items.resize(shared.items.size() - n);
+            if (list->items.empty()) {
+                return nullptr;
+            }
+        }
+        T *item = list->items.back();
+        list->items.pop_back();
+        return item;
     }
-};
 
-class ElapseFormatItem : public LogFormatter::FormatItem {
-public:
-    ElapseFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getElapse();
+    /**
+     * @brief 放回空闲对象，列表已满或线程正在退出时返回false，由调用方释放
+     */
+    static bool Push(T *item) {
+        List *list = GetList();
+        if (!list) {
+            return false;
+        }
+        if (list->items.size() >= kMaxFreeItems) {
+            Shared &shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            size_t n = std::min(kFreeBatch, kMaxSharedFreeItems - shared.items.size());
+            if (n == 0) {
+                return false;
+            }
+            shared.items.insert(shared.items.end(), list->items.end() - n, list->items.end());
+            list->items.resize(list->items.size() - n);
+        }
+        list->items.push_back(item);
+        return true;
     }
-};
 
-class NameFormatItem : public LogFormatter::FormatItem {
-public:
-    NameFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getThreadName();
-    }
-};
+private:
+    struct List {
+        explicit List(bool *dead) : dead(dead) {items.reserve(kMaxFreeItems);}
+        ~List() {
+            for (auto item : items) {
+                Tag::Destroy(item);
+            }
+            *dead = true;
+        }
+        bool *dead;
+        std::vector<T*> items;
+    };
 
-class ThreadIdFormatItem : public LogFormatter::FormatItem {
-public:
-    ThreadIdFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getThreadId();
-    }
-};
+    struct Shared {
+        std::mutex mutex;
+        std::vector<T*> items;
+    };
 
-class NewLineFormatItem : public LogFormatter::FormatItem {
-public:
-    NewLineFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << std::endl;
+    /**
+     * @brief 各线程共用的空闲列表，不释放，保证线程退出时仍可使用
+     */
+    static Shared& GetShared() {
+        static Shared *s_shared = new Shared;
+        return *s_shared;
     }
-};
 
-class DateTimeFormatItem : public LogFormatter::FormatItem {
-public:
-    DateTimeFormatItem(const std::string &format = "%Y-%m-%d %H:%M:%S") : m_format(format) {
-        if (m_format.empty()) {
-            m_format = "%Y-%m-%d %H:%M:%S";
-        }
-    }
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        struct tm tm;
-        time_t time = event->getTime();
-        localtime_r(&time, &tm);
-        constexpr int bufferSize = 1000;
-        char buf[bufferSize];
-        strftime(buf, sizeof(buf), m_format.c_str(), &tm);
-        os << buf;
+    static List* GetList() {
+        static thread_local bool t_dead = false;
+        if (t_dead) {
+            return nullptr;
+        }
+        static thread_local List t_list(&t_dead);
+        return &t_list;
     }
-private:
-    std::string m_format;
 };
 
-class FilenameFormatItem : public LogFormatter::FormatItem {
-public:
-    FilenameFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getFile();
-    }
+struct LogEventTag {
+    static void Destroy(LogEvent *event) {delete event;}
 };
 
-class LineFormatItem : public LogFormatter::FormatItem {
-public:
-    LineFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getLine();
-    }
+template<size_t SIZE>
+struct BlockTag {
+    static void Destroy(void *block) {::operator delete(block);}
 };
 
-class TabFormatItem : public LogFormatter::FormatItem {
-public:
-    TabFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << "\t";
+/**
+ * @brief shared_ptr控制块的分配器，按大小复用线程本地的内存块
+ */
+template<class T>
+struct LogEventAllocator {
+    typedef T value_type;
+
+    LogEventAllocator() = default;
+
+    template<class U>
+    LogEventAllocator(const LogEventAllocator<U> &) {}
+
+    T* allocate(size_t n) {
+        if (n == 1) {
+            void *block = ThreadFreeList<void, BlockTag<sizeof(T)>>::Pop();
+            if (block) {
+                return static_cast<T*>(block);
+            }
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
     }
-};
 
-class FiberIdFormatItem : public LogFormatter::FormatItem {
-public:
-    FiberIdFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getFiberId();
+    void deallocate(T *p, size_t n) {
+        if (n != 1 || !ThreadFreeList<void, BlockTag<sizeof(T)>>::Push(p)) {
+            ::operator delete(p);
+        }
     }
 };
 
-class ThreadNameFormatItem : public LogFormatter::FormatItem {
-public:
-    ThreadNameFormatItem(const std::string &str = "") {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) {
-        os << event->getThreadName();
+template<class T, class U>
+bool operator==(const LogEventAllocator<T> &, const LogEventAllocator<U> &) {return true;}
+
+template<class T, class U>
+bool operator!=(const LogEventAllocator<T> &, const LogEventAllocator<U> &) {return false;}
+
+}
+
+LogEvent::LogEventPtr LogEventPool::Acquire(std::shared_ptr<Logger> logger, LogLevel::Level level,
+                                            const char *file, int32_t line, uint32_t elapse,
+                                            uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+                                            const std::string &thread_name) {
+    LogEvent *event = ThreadFreeList<LogEvent, LogEventTag>::Pop();
+    if (!event) {
+        event = new LogEvent;
     }
-};
+    event->reset(std::move(logger), level, file, line, elapse, thread_id, fiber_id, timestamp, thread_name);
+    return LogEvent::LogEventPtr(event, &LogEventPool::Release, LogEventAllocator<LogEvent>());
+}
 
-class StringFormatItem : public LogFormatter::FormatItem {
-public:
-    explicit StringFormatItem(const std::string &str) : m_string(str) {}
-    void format(std::ostream& os,
-                Logger::LoggerPtr logger,
-                LogLevel::Level level,
-                LogEvent::LogEventPtr event) override {
-        os << m_string;
+void LogEventPool::Release(LogEvent *event) {
+    //先释放对日志器的引用，避免空闲事件延长其生命周期
+    event->m_logger.reset();
+    if (!ThreadFreeList<LogEvent, LogEventTag>::Push(event)) {
+        delete event;
     }
-private:
-    std::string m_string;
-};
+}
 
 LogEventWrap::LogEventWrap(LogEvent::LogEventPtr event) : m_event(event) {
 }
 
+LogEventWrap::LogEventWrap(const std::shared_ptr<Logger> &logger, LogLevel::Level level, LogSite &site) {
+    LogThreadContext &context = LogThreadContext::Current();
+    uint64_t now = LogClock::Now();
+    init(logger, level, site, LogThreadContext::Elapse(now), context.getThreadId(), context.getFiberId(), now,
+         context.getThreadName());
+}
+
+LogEventWrap::LogEventWrap(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                           LogSite &site, uint32_t elapse,
+                           uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+                           const std::string &thread_name) {
+    init(logger, level, site, elapse, thread_id, fiber_id, timestamp, thread_name);
+}
+
+void LogEventWrap::init(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                        LogSite &site, uint32_t elapse,
+                        uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+                        const std::string &thread_name) {
+    m_event = LogEventPool::Acquire(logger, level, site.getFile(), site.getLine(), elapse,
+                                    thread_id, fiber_id, timestamp, thread_name);
+    m_event->setSite(&site);
+    //级别被过滤的事件只进入LogFlightRecorder，不取走跳过的数量
+    uint64_t suppressed = level >= logger->getLevel() ? site.takeSuppressed() : 0;
+    if (suppressed) {
+        //先补一条限流或采样跳过的数量
+        LogEvent::LogEventPtr event = LogEventPool::Acquire(logger, level, site.getFile(), site.getLine(), elapse,
+                                                            thread_id, fiber_id, timestamp, thread_name);
+        event->setSite(&site);
+        event->getSS() << "suppressed " << suppressed << " records since last output";
+        logger->log(level, event);
+    }
+}
+
+void LogEventWrap::Format(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                          LogSite &site, const char *fmt, ...) {
+    LogEventWrap wrap(logger, level, site);
+    va_list al;
+    va_start(al, fmt);
+    wrap.m_event->format(fmt, al);
+    va_end(al);
+}
+
 LogEventWrap::~LogEventWrap() {
     //write logger before delete object
+    if (LogFlightRecorder::IsEnabled()) {
+        LogFlightRecorder::RecordEvent(*m_event);
+    }
     m_event->getLogger()->log(m_event->getLevel(), m_event);
 }
 
-std::stringstream& LogEventWrap::getSS() {
+LogStream& LogEventWrap::getSS() {
     return m_event->getSS();
 }
 
@@ -251,23 +336,87 @@ LogFormatter::LogFormatter(const std::string &pattern) : m_pattern(pattern) {
 }
 
 std::string LogFormatter::format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event) {
-    std::stringstream ss;
-    for (auto & item : m_items) {
-        item->format(ss, logger, level, event);
-    }
-    ss << std::endl;
-    return ss.str();
+    static thread_local LogBuffer t_buffer;
+    t_buffer.clear();
+    format(t_buffer, logger, level, event);
+    return t_buffer.toString();
 }
 
 std::ostream& LogFormatter::format(std::ostream &ofs, std::shared_ptr<Logger> logger, LogLevel::Level level,
                                    LogEvent::LogEventPtr event) {
-    for (auto & item : m_items) {
-        item->format(ofs, logger, level, event);
-    }
-    ofs << std::endl;
+    static thread_local LogBuffer t_buffer;
+    t_buffer.clear();
+    format(t_buffer, logger, level, event);
+    ofs.write(t_buffer.data(), t_buffer.size());
     return ofs;
 }
 
+void LogFormatter::format(LogBuffer &buf, const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                          const LogEvent::LogEventPtr &event) {
+    for (auto &op : m_ops) {
+        switch (op.code) {
+            case OP_LITERAL:
+                buf.append(m_literals.data() + op.offset, op.len);
+                break;
+            case OP_MESSAGE: {
+                StringView content = event->getContent();
+                buf.append(content.data(), content.size());
+                event->getFields().appendText(buf);
+                break;
+            }
+            case OP_LEVEL:
+                buf.append(LogLevel::toString(level));
+                break;
+            case OP_ELAPSE:
+                buf.appendUInt(event->getElapse());
+                break;
+            case OP_THREAD_ID:
+                buf.appendUInt(event->getThreadId());
+                break;
+            case OP_NEWLINE:
+                buf.append('\n');
+                break;
+            case OP_DATETIME:
+                m_dateFormats[op.offset].format(buf, event->getWallTime());
+                break;
+            case OP_FILENAME:
+                buf.append(event->getFile());
+                break;
+            case OP_LINE:
+                buf.appendInt(event->getLine());
+                break;
+            case OP_TAB:
+                buf.append('\t');
+                break;
+            case OP_FIBER_ID:
+                buf.appendUInt(event->getFiberId());
+                break;
+            case OP_NAME:
+            case OP_THREAD_NAME:
+                buf.append(event->getThreadName());
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void LogFormatter::addOp(uint8_t code, const std::string &arg) {
+    Op op;
+    op.code = code;
+    if (code == OP_DATETIME) {
+        op.offset = static_cast<uint32_t>(m_dateFormats.size());
+        op.len = 0;
+        m_dateFormats.push_back(DateTimeFormat(arg));
+    }
+    else {
+        op.offset = static_cast<uint32_t>(m_literals.size());
+        op.len = static_cast<uint32_t>(arg.size());
+        m_literals.append(arg);
+    }
+    m_ops.push_back(op);
+}
+
 //%xxx or %xxx{xxx} or %%
 //需要解析出以上三种格式
 void LogFormatter::init() {
@@ -352,64 +501,223 @@ void LogFormatter::init() {
         vec.push_back(std::make_tuple(nstr, "", 0));
     }
 
-    static std::map<std::string, std::function<FormatItem::FormatItemPtr(const std::string& str)>>  s_format_item = {
-#define Func(str, C) \
-        {#str, [](const std::string &fmt){return FormatItem::FormatItemPtr(new C(fmt));}}
-
-        Func(m, MessageFormatItem),           //m:消息
-        Func(p, LevelFormatItem),             //p:日志级别
-        Func(r, ElapseFormatItem),            //r:累计毫秒数
-        Func(c, NameFormatItem),              //c:日志名称
-        Func(t, ThreadIdFormatItem),          //t:线程id
-        Func(n, NewLineFormatItem),           //n:换行
-        Func(d, DateTimeFormatItem),          //d:时间
-        Func(f, FilenameFormatItem),          //f:文件名
-        Func(l, LineFormatItem),              //l:行号
-        Func(T, TabFormatItem),               //T:Tab
-        Func(F, FiberIdFormatItem),           //F:协程id
-        Func(N, ThreadNameFormatItem),        //N:线程名称
+    static std::map<std::string, uint8_t> s_format_ops = {
+#define Func(str, code) \
+        {#str, code}
+
+        Func(m, OP_MESSAGE),                  //m:消息
+        Func(p, OP_LEVEL),                    //p:日志级别
+        Func(r, OP_ELAPSE),                   //r:累计毫秒数
+        Func(c, OP_NAME),                     //c:日志名称
+        Func(t, OP_THREAD_ID),                //t:线程id
+        Func(n, OP_NEWLINE),                  //n:换行
+        Func(d, OP_DATETIME),                 //d:时间
+        Func(f, OP_FILENAME),                 //f:文件名
+        Func(l, OP_LINE),                     //l:行号
+        Func(T, OP_TAB),                      //T:Tab
+        Func(F, OP_FIBER_ID),                 //F:协程id
+        Func(N, OP_THREAD_NAME),              //N:线程名称
 #undef Func
     };
 
     for (auto & i : vec) {
         if (std::get<2>(i) == 0) {
-            m_items.push_back(FormatItem::FormatItemPtr(new StringFormatItem(std::get<0>(i))));
+            addOp(OP_LITERAL, std::get<0>(i));
         }
         else {
-            auto it = s_format_item.find(std::get<0>(i));
-            if (it == s_format_item.end()) {
-                m_items.push_back(FormatItem::FormatItemPtr(new StringFormatItem("<<error_format %" + std::get<0>(i) + ">>")));
+            auto it = s_format_ops.find(std::get<0>(i));
+            if (it == s_format_ops.end()) {
+                addOp(OP_LITERAL, "<<error_format %" + std::get<0>(i) + ">>");
                 m_error = true;
             }
             else {
-                m_items.push_back(it->second(std::get<1>(i)));
+                addOp(it->second, std::get<1>(i));
             }
         }
     }
 }
 
 LogFormatter::LogFormatterPtr LogAppender::getFormatter() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_formatter;
 }
 
 void LogAppender::setFormatter(LogFormatter::LogFormatterPtr formatter) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_formatter = formatter;
     if (m_formatter) m_hasFormatter = true;
     else m_hasFormatter = false;
+    m_formatterVersion.fetch_add(1, std::memory_order_release);
+}
+
+void LogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event) {
+    if (level >= m_level && !logDirect(logger, level, event)) {
+        static thread_local LogBuffer t_buffer;
+        t_buffer.clear();
+        getFormatter()->format(t_buffer, logger, level, event);
+        logFormatted(level, t_buffer.data(), t_buffer.size());
+    }
+}
+
+void LogAppender::logFormatted(LogLevel::Level level, const char *data, size_t len) {
+    append(data, len);
+    if (level >= m_flushLevel.load(std::memory_order_relaxed)) {
+        flush();
+    }
+}
+
+void LogAppender::append(const char *data, size_t len) {
+    if (m_staging.load(std::memory_order_relaxed)) {
+        LogStagingBuffer::GetThis()->append(this, data, len);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writeBuffer(data, len);
+}
+
+void LogAppender::flush() {
+    if (m_staging.load(std::memory_order_relaxed)) {
+        LogStagingBuffer::GetThis()->flush();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    flushBuffer();
+}
+
+void LogAppender::setFlushPolicy(const FlushPolicy &policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_flushPolicy = policy;
+    m_flushLevel.store(policy.level, std::memory_order_relaxed);
+    m_flushOnSignal.store(policy.onSignal, std::memory_order_relaxed);
+}
+
+FlushPolicy LogAppender::getFlushPolicy() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_flushPolicy;
+}
+
+static uint64_t steadyMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 写入全部数据，出错时放弃，可在信号处理函数中调用
+ */
+static void writeAll(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void BufferedLogAppender::registerFlush() {
+    if (KAFKA_UNLIKELY(!m_registered)) {
+        m_registered = true;
+        LoggerMgr::GetInstance()->addFlushAppender(
+            std::static_pointer_cast<BufferedLogAppender>(shared_from_this()));
+    }
+}
+
+bool BufferedLogAppender::logDirect(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                                    const LogEvent::LogEventPtr &event) {
+    if (m_staging.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    registerFlush();
+    {
+        SignalGuard guard(m_signalBusy);
+        m_formatter->format(m_buffer, logger, level, event);
+    }
+    if (level >= m_flushPolicy.level || m_buffer.size() >= m_flushPolicy.bytes) {
+        flushBuffer();
+    }
+    return true;
+}
+
+void BufferedLogAppender::writeBuffer(const char *data, size_t len) {
+    registerFlush();
+    {
+        SignalGuard guard(m_signalBusy);
+        if (m_buffer.empty() && len >= m_flushPolicy.bytes) {
+            //大块数据(如暂存缓冲区交出的批量日志)直接写出
+            writeOutput(data, len);
+            m_lastFlush = steadyMilliseconds();
+            return;
+        }
+        m_buffer.append(data, len);
+    }
+    if (m_buffer.size() >= m_flushPolicy.bytes) {
+        flushBuffer();
+    }
+}
+
+void BufferedLogAppender::flushBuffer() {
+    SignalGuard guard(m_signalBusy);
+    if (!m_buffer.empty()) {
+        writeOutput(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+    m_lastFlush = steadyMilliseconds();
+}
+
+void BufferedLogAppender::flushIfDue(uint64_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_buffer.empty() && m_flushPolicy.interval && now - m_lastFlush >= m_flushPolicy.interval) {
+        flushBuffer();
+    }
 }
 
-Logger::Logger(const std::string &name) : m_level(LogLevel::DEBUG), m_name(name) {
+void BufferedLogAppender::flushForSignal() {
+    //信号可能发生在修改缓冲区的过程中，此时放弃
+    if (m_signalBusy.exchange(true, std::memory_order_acquire)) {
+        return;
+    }
+    int fd = getOutputFd();
+    if (fd >= 0 && !m_buffer.empty()) {
+        writeAll(fd, m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+    m_signalBusy.store(false, std::memory_order_release);
+}
+
+Logger::Logger(const std::string &name)
+    : m_level(LogLevel::DEBUG), m_name(name), m_appenders(new AppenderList), m_dispatcher(nullptr),
+      m_hasDedup(false), m_dedupRegistered(false) {
     m_formatter.reset(new LogFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n"));
 }
 
-void Logger::setFormatter(LogFormatter::LogFormatterPtr formatter) {
-    m_formatter = formatter;
+Logger::~Logger() {
+    //正在输出的线程持有日志器，析构时已没有读者
+    delete m_appenders.load(std::memory_order_relaxed);
+}
 
-    for (auto &item : m_appenders) {
-        if (!item->m_hasFormatter) {
-            item->m_formatter = m_formatter;
+void Logger::setFormatter(LogFormatter::LogFormatterPtr formatter) {
+    const AppenderList *old;
+    {
+        std::lock_guard<std::mutex> lock(m_appenderMutex);
+        m_formatter = formatter;
+
+        std::vector<LogAppender::LogAppenderPtr> appenders;
+        for (auto &item : *m_appenders.load(std::memory_order_relaxed)) {
+            LogAppender &appender = *item.appender;
+            std::lock_guard<std::mutex> appenderLock(appender.m_mutex);
+            if (!appender.m_hasFormatter) {
+                appender.m_formatter = m_formatter;
+                appender.m_formatterVersion.fetch_add(1, std::memory_order_release);
+            }
+            appenders.push_back(item.appender);
         }
+        old = publishAppenders(appenders);
     }
+    LogRcu::Retire(old);
 }
 
 void Logger::setFormatter(const std::string &str) {
@@ -424,43 +732,217 @@ void Logger::setFormatter(const std::string &str) {
 }
 
 LogFormatter::LogFormatterPtr Logger::getFormatter() {
+    std::lock_guard<std::mutex> lock(m_appenderMutex);
     return m_formatter;
 }
 
 void Logger::addAppender(LogAppender::LogAppenderPtr appender) {
-    if (!appender->getFormatter()) {
-        appender->setFormatter(m_formatter);
+    const AppenderList *old;
+    {
+        std::lock_guard<std::mutex> lock(m_appenderMutex);
+        if (!appender->getFormatter()) {
+            appender->setFormatter(m_formatter);
+        }
+        std::vector<LogAppender::LogAppenderPtr> appenders;
+        for (auto &item : *m_appenders.load(std::memory_order_relaxed)) {
+            appenders.push_back(item.appender);
+        }
+        appenders.push_back(appender);
+        old = publishAppenders(appenders);
     }
-    m_appenders.push_back(appender);
+    LogRcu::Retire(old);
 }
 
 void Logger::delAppender(LogAppender::LogAppenderPtr appender) {
-    for (auto it = m_appenders.begin(); it != m_appenders.end(); it++) {
-        if (*it == appender) {
-            m_appenders.erase(it);
-            break;
+    const AppenderList *old = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_appenderMutex);
+        std::vector<LogAppender::LogAppenderPtr> appenders;
+        bool found = false;
+        for (auto &item : *m_appenders.load(std::memory_order_relaxed)) {
+            if (item.appender == appender && !found) {
+                found = true;
+                continue;
+            }
+            appenders.push_back(item.appender);
+        }
+        if (found) {
+            old = publishAppenders(appenders);
         }
     }
+    //旧快照可能持有appender的最后一个引用，析构时会写出缓冲区，不能在持有m_appenderMutex时释放
+    LogRcu::Retire(old);
 }
 
 void Logger::cleanAppender() {
-    m_appenders.clear();
+    const AppenderList *old = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_appenderMutex);
+        if (!m_appenders.load(std::memory_order_relaxed)->empty()) {
+            old = publishAppenders(std::vector<LogAppender::LogAppenderPtr>());
+        }
+    }
+    LogRcu::Retire(old);
 }
 
+const Logger::AppenderList* Logger::publishAppenders(const std::vector<LogAppender::LogAppenderPtr> &appenders) {
+    AppenderList *list = new AppenderList;
+    list->reserve(appenders.size());
+    for (auto &item : appenders) {
+        std::lock_guard<std::mutex> lock(item->m_mutex);
+        list->push_back(AppenderEntry{item, item->m_formatter,
+                                      item->m_formatterVersion.load(std::memory_order_relaxed), false});
+    }
+    //格式器共用关系只在发布时计算一次
+    for (size_t i = 0; i < list->size(); ++i) {
+        for (size_t j = i + 1; j < list->size(); ++j) {
+            if ((*list)[i].formatter == (*list)[j].formatter) {
+                (*list)[i].shared = (*list)[j].shared = true;
+            }
+        }
+    }
+    return m_appenders.exchange(list, std::memory_order_acq_rel);
+}
+
+void Logger::setDispatcher(std::shared_ptr<AsyncLogDispatcher> dispatcher) {
+    std::shared_ptr<AsyncLogDispatcher> old;
+    {
+        std::lock_guard<std::mutex> lock(m_appenderMutex);
+        old.swap(m_dispatcherOwner);
+        m_dispatcherOwner = dispatcher;
+        m_dispatcher.store(dispatcher.get(), std::memory_order_release);
+    }
+    if (old) {
+        //正在投递的线程用完后才释放旧的分发器
+        LogRcu::Retire([old]() mutable {old.reset();});
+    }
+}
+
+std::shared_ptr<AsyncLogDispatcher> Logger::getDispatcher() {
+    std::lock_guard<std::mutex> lock(m_appenderMutex);
+    return m_dispatcherOwner;
+}
 
+void Logger::setBinaryLogFile(const std::string &filename) {
+    std::shared_ptr<BinaryLogWriter> writer;
+    if (!filename.empty()) {
+        writer.reset(new BinaryLogWriter(filename, m_name));
+    }
+    //正在写入的调用方持有旧写入器的副本，写完后才关闭
+    std::atomic_store(&m_binaryWriter, writer);
+}
+
+void Logger::setDedupWindow(uint32_t window) {
+    std::shared_ptr<LogDedupFilter> dedup;
+    if (window) {
+        dedup.reset(new LogDedupFilter(window));
+    }
+    std::atomic_store(&m_dedup, dedup);
+    m_hasDedup.store(window != 0, std::memory_order_release);
+    //多次设置时只登记一次
+    if (window && !m_dedupRegistered.exchange(true)) {
+        LoggerMgr::GetInstance()->addDedupLogger(shared_from_this());
+    }
+}
+
+void Logger::expireDedup(uint64_t now) {
+    std::shared_ptr<LogDedupFilter> dedup = std::atomic_load(&m_dedup);
+    if (dedup) {
+        LogEvent::LogEventPtr summary = dedup->expire(shared_from_this(), now);
+        if (summary) {
+            output(summary->getLevel(), summary);
+        }
+    }
+}
 
 void Logger::log(LogLevel::Level level, const LogEvent::LogEventPtr &event) {
     if (level >= m_level) {
-        auto self = shared_from_this();
-        if (!m_appenders.empty()) {
-            for (auto &item : m_appenders) {
-                item->log(self, level, event);
+        std::shared_ptr<LogDedupFilter> dedup;
+        if (KAFKA_UNLIKELY(m_hasDedup.load(std::memory_order_acquire)) && (dedup = std::atomic_load(&m_dedup))) {
+            LogEvent::LogEventPtr summary;
+            bool repeated = dedup->filter(shared_from_this(), event, summary);
+            if (summary) {
+                output(summary->getLevel(), summary);
+            }
+            if (repeated) {
+                return;
             }
         }
-        else if (m_root) {
-            m_root->log(level, event);
+        output(level, event);
+    }
+}
+
+void Logger::output(LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+    {
+        LogRcu::ReadGuard guard;
+        AsyncLogDispatcher *dispatcher = m_dispatcher.load(std::memory_order_acquire);
+        if (dispatcher) {
+            dispatcher->dispatch(this, level, event);
+            return;
+        }
+    }
+    doLog(level, event);
+}
+
+void Logger::doLog(LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+    //事件通常由当前日志器创建，直接使用事件持有的引用，避免每条日志都修改日志器的引用计数
+    LoggerPtr owner;
+    const LoggerPtr *logger = &event->getLogger();
+    if (KAFKA_UNLIKELY(logger->get() != this)) {
+        //根日志器输出子日志器的事件
+        owner = shared_from_this();
+        logger = &owner;
+    }
+    const LoggerPtr &self = *logger;
+    LogRcu::ReadGuard guard;
+    const AppenderList *appenders = m_appenders.load(std::memory_order_acquire);
+    if (!appenders->empty()) {
+        //每个不同的格式器只格式化一次，结果依次放在t_buffer中供共用该格式器的appender使用
+        struct Rendered {
+            LogFormatter *formatter;
+            size_t begin;
+            size_t end;
+        };
+        static thread_local LogBuffer t_buffer;
+        Rendered rendered[kMaxSharedFormatters];
+        size_t count = 0;
+        t_buffer.clear();
+        for (auto &item : *appenders) {
+            LogAppender *appender = item.appender.get();
+            if (level < appender->m_level) {
+                continue;
+            }
+            if (KAFKA_UNLIKELY(appender->m_formatterVersion.load(std::memory_order_acquire) != item.version)) {
+                //快照发布后appender设置了新的格式器，由它自己格式化
+                appender->log(self, level, event);
+                continue;
+            }
+            //格式器只有这一个appender使用时直接格式化到它的缓冲区
+            if (!item.shared && appender->logDirect(self, level, event)) {
+                continue;
+            }
+            LogFormatter *formatter = item.formatter.get();
+            size_t i = 0;
+            while (i < count && rendered[i].formatter != formatter) {
+                ++i;
+            }
+            if (i == count) {
+                if (count == kMaxSharedFormatters) {
+                    appender->log(self, level, event);
+                    continue;
+                }
+                rendered[i].formatter = formatter;
+                rendered[i].begin = t_buffer.size();
+                formatter->format(t_buffer, self, level, event);
+                rendered[i].end = t_buffer.size();
+                ++count;
+            }
+            appender->logFormatted(level, t_buffer.data() + rendered[i].begin, rendered[i].end - rendered[i].begin);
         }
     }
+    else if (m_root) {
+        m_root->log(level, event);
+    }
 }
 
 void Logger::debug(LogEvent::LogEventPtr event) {
@@ -483,10 +965,18 @@ void Logger::fatal(LogEvent::LogEventPtr event) {
     log(LogLevel::FATAL, event);
 }
 
-void StdoutLogAppender::log(Logger::LoggerPtr logger, LogLevel::Level level, LogEvent::LogEventPtr event) {
-    if (level >= m_level) {
-        std::cout << m_formatter->format(logger, level, event);
-    }
+StdoutLogAppender::~StdoutLogAppender() {
+    //暂存缓冲区持有appender，析构时已没有暂存的数据
+    std::lock_guard<std::mutex> lock(m_mutex);
+    flushBuffer();
+}
+
+void StdoutLogAppender::writeOutput(const char *data, size_t len) {
+    writeAll(STDOUT_FILENO, data, len);
+}
+
+int StdoutLogAppender::getOutputFd() const {
+    return STDOUT_FILENO;
 }
 
 std::string StdoutLogAppender::toYamlString() {
@@ -494,16 +984,22 @@ std::string StdoutLogAppender::toYamlString() {
 }
 
 FileLogAppender::FileLogAppender(const std::string &filename) : m_filename(filename) {
-    m_filestream.open(filename, std::ios::out | std::ios::app);
+    m_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
 }
 
 FileLogAppender::~FileLogAppender() {
-    m_filestream.close();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        flushBuffer();
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
 }
 
-void FileLogAppender::log(Logger::LoggerPtr logger, LogLevel::Level level, LogEvent::LogEventPtr event) {
-    if (level >= m_level) {
-        m_filestream << m_formatter->format(logger, level, event);
+void FileLogAppender::writeOutput(const char *data, size_t len) {
+    if (m_fd >= 0) {
+        writeAll(m_fd, data, len);
     }
 }
 
@@ -513,31 +1009,99 @@ std::string FileLogAppender::toYamlString() {
 }
 
 bool FileLogAppender::reopen() {
-    if (m_filestream) {
-        m_filestream.close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    flushBuffer();
+    SignalGuard guard(m_signalBusy);
+    if (m_fd >= 0) {
+        ::close(m_fd);
     }
-    m_filestream.open(m_filename);
-    return !!m_filestream;
+    m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    return m_fd >= 0;
+}
+
+AsyncFileLogAppender::AsyncFileLogAppender(const std::string &filename, int flushInterval)
+    : m_filename(filename), m_writer(new AsyncLogWriter(filename, flushInterval)) {
+    m_writer->start();
+}
+
+AsyncFileLogAppender::~AsyncFileLogAppender() {
+    m_writer->stop();
+}
+
+void AsyncFileLogAppender::writeBuffer(const char *data, size_t len) {
+    m_writer->append(data, len);
+}
+
+std::string AsyncFileLogAppender::toYamlString() {
+    return "";
 }
 
-LoggerManager::LoggerManager() {
+void AsyncFileLogAppender::reopen() {
+    m_writer->reopen();
+}
+
+LoggerManager::LoggerManager() : m_signalCount(0), m_stagingThreshold(64 * 1024), m_stagingInterval(100) {
     m_root.reset(new Logger);
     m_root->addAppender(LogAppender::LogAppenderPtr(new StdoutLogAppender));
 
-    m_loggers[m_root->getName()] = m_root;
+    for (auto &shard : m_shards) {
+        shard.snapshot.store(new LoggerMap, std::memory_order_relaxed);
+    }
+    LoggerMap *loggers = new LoggerMap;
+    loggers->emplace(m_root->getName(), m_root);
+    LoggerShard &shard = getShard(m_root->getName());
+    delete shard.snapshot.exchange(loggers, std::memory_order_release);
 
     init();
 }
 
-Logger::LoggerPtr LoggerManager::getLogger(const std::string name) {
-    auto it = m_loggers.find(name);
-    if (it != m_loggers.end()) {
-        return it->second;
+LoggerManager::~LoggerManager() {
+    {
+        std::lock_guard<std::mutex> lock(m_stagingMutex);
+        m_stagingRunning = false;
+    }
+    m_stagingCond.notify_one();
+    if (m_stagingThread.joinable()) {
+        m_stagingThread.join();
+    }
+    flushStagingBuffers();
+    expireDedupLoggers(UINT64_MAX);
+    flushAppenders(true);
+    for (auto &shard : m_shards) {
+        delete shard.snapshot.load(std::memory_order_relaxed);
+    }
+}
+
+Logger::LoggerPtr LoggerManager::getLogger(const std::string &name) {
+    LoggerShard &shard = getShard(name);
+    {
+        LogRcu::ReadGuard guard;
+        const LoggerMap *loggers = shard.snapshot.load(std::memory_order_acquire);
+        auto it = loggers->find(name);
+        if (KAFKA_LIKELY(it != loggers->end())) {
+            return it->second;
+        }
     }
 
-    Logger::LoggerPtr logger(new Logger(name));
-    logger->setRootLogger(m_root);
-    m_loggers[name] = logger;
+    Logger::LoggerPtr logger;
+    const LoggerMap *loggers;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        //加锁前其他线程可能已经创建
+        loggers = shard.snapshot.load(std::memory_order_relaxed);
+        auto it = loggers->find(name);
+        if (it != loggers->end()) {
+            return it->second;
+        }
+
+        logger.reset(new Logger(name));
+        logger->setRootLogger(m_root);
+        LoggerMap *next = new LoggerMap(*loggers);
+        next->emplace(name, logger);
+        shard.snapshot.store(next, std::memory_order_release);
+    }
+    //Retire可能释放其他已登记的对象，不在持有shard.mutex时调用
+    LogRcu::Retire(loggers);
     return logger;
 }
 
@@ -549,4 +1113,176 @@ std::string LoggerManager::toYamlString() {
     return "";
 }
 
+void LoggerManager::addStagingBuffer(const std::shared_ptr<LogStagingBuffer> &buffer) {
+    std::lock_guard<std::mutex> lock(m_stagingMutex);
+    m_stagingBuffers.push_back(buffer);
+    if (!m_stagingRunning) {
+        m_stagingRunning = true;
+        m_stagingThread = std::thread(&LoggerManager::stagingThreadFunc, this);
+    }
+}
+
+void LoggerManager::delStagingBuffer(const std::shared_ptr<LogStagingBuffer> &buffer) {
+    std::lock_guard<std::mutex> lock(m_stagingMutex);
+    for (auto it = m_stagingBuffers.begin(); it != m_stagingBuffers.end(); ++it) {
+        if (*it == buffer) {
+            m_stagingBuffers.erase(it);
+            break;
+        }
+    }
+}
+
+void LoggerManager::setStagingInterval(uint32_t v) {
+    m_stagingInterval = v;
+    m_stagingCond.notify_one();
+}
+
+void LoggerManager::flushStagingBuffers() {
+    std::vector<std::shared_ptr<LogStagingBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_stagingMutex);
+        buffers = m_stagingBuffers;
+    }
+    for (auto &item : buffers) {
+        item->flush();
+    }
+}
+
+void LoggerManager::addFlushAppender(const std::shared_ptr<BufferedLogAppender> &appender) {
+    std::lock_guard<std::mutex> lock(m_stagingMutex);
+    m_flushAppenders.push_back(appender);
+    if (m_signalInstalled && appender->m_flushOnSignal.load(std::memory_order_relaxed)) {
+        addSignalAppender(appender);
+    }
+    if (!m_stagingRunning) {
+        m_stagingRunning = true;
+        m_stagingThread = std::thread(&LoggerManager::stagingThreadFunc, this);
+    }
+}
+
+void LoggerManager::flushAppenders(bool force) {
+    std::vector<std::shared_ptr<BufferedLogAppender>> appenders;
+    {
+        std::lock_guard<std::mutex> lock(m_stagingMutex);
+        for (auto it = m_flushAppenders.begin(); it != m_flushAppenders.end();) {
+            auto appender = it->lock();
+            if (appender) {
+                appenders.push_back(appender);
+                ++it;
+            }
+            else {
+                it = m_flushAppenders.erase(it);
+            }
+        }
+    }
+    uint64_t now = steadyMilliseconds();
+    for (auto &item : appenders) {
+        if (force) {
+            item->flush();
+        }
+        else {
+            item->flushIfDue(now);
+        }
+    }
+}
+
+void LoggerManager::addDedupLogger(const Logger::LoggerPtr &logger) {
+    std::lock_guard<std::mutex> lock(m_stagingMutex);
+    m_dedupLoggers.push_back(logger);
+    if (!m_stagingRunning) {
+        m_stagingRunning = true;
+        m_stagingThread = std::thread(&LoggerManager::stagingThreadFunc, this);
+    }
+}
+
+void LoggerManager::expireDedupLoggers(uint64_t now) {
+    std::vector<Logger::LoggerPtr> loggers;
+    {
+        std::lock_guard<std::mutex> lock(m_stagingMutex);
+        for (auto it = m_dedupLoggers.begin(); it != m_dedupLoggers.end();) {
+            auto logger = it->lock();
+            if (logger) {
+                loggers.push_back(logger);
+                ++it;
+            }
+            else {
+                it = m_dedupLoggers.erase(it);
+            }
+        }
+    }
+    for (auto &item : loggers) {
+        item->expireDedup(now);
+    }
+}
+
+void LoggerManager::addSignalAppender(const std::shared_ptr<BufferedLogAppender> &appender) {
+    size_t count = m_signalCount.load(std::memory_order_relaxed);
+    if (count < kMaxSignalAppenders) {
+        m_signalOwners.push_back(appender);
+        m_signalAppenders[count] = appender.get();
+        m_signalCount.store(count + 1, std::memory_order_release);
+    }
+}
+
+void LoggerManager::installFlushSignalHandler() {
+    //登记已有的输出目标，之后首次写入的输出目标由addFlushAppender登记
+    std::vector<std::shared_ptr<BufferedLogAppender>> appenders;
+    {
+        std::lock_guard<std::mutex> lock(m_stagingMutex);
+        if (!m_signalInstalled) {
+            m_signalInstalled = true;
+            for (auto &item : m_flushAppenders) {
+                auto appender = item.lock();
+                if (appender) {
+                    appenders.push_back(appender);
+                }
+            }
+        }
+    }
+    for (auto &item : appenders) {
+        if (item->m_flushOnSignal.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m_stagingMutex);
+            addSignalAppender(item);
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &LoggerManager::FlushSignalHandler;
+    sigemptyset(&sa.sa_mask);
+    //处理一次后恢复默认处理
+    sa.sa_flags = SA_RESETHAND;
+    const int signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+    for (int sig : signals) {
+        sigaction(sig, &sa, nullptr);
+    }
+}
+
+void LoggerManager::FlushSignalHandler(int sig) {
+    if (LogFlightRecorder::IsEnabled()) {
+        LogFlightRecorder::Dump(nullptr, sig);
+    }
+    //信号可能发生在持有锁时，只读取登记的裸指针，不加锁，不改变引用计数
+    LoggerManager *mgr = LoggerMgr::GetInstance();
+    size_t count = mgr->m_signalCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        mgr->m_signalAppenders[i]->flushForSignal();
+    }
+    raise(sig);
+}
+
+void LoggerManager::stagingThreadFunc() {
+    std::unique_lock<std::mutex> lock(m_stagingMutex);
+    while (m_stagingRunning) {
+        m_stagingCond.wait_for(lock, std::chrono::milliseconds(getStagingInterval()));
+        lock.unlock();
+        flushStagingBuffers();
+        expireDedupLoggers(steadyMilliseconds());
+        flushAppenders(false);
+        LogClock::Recalibrate();
+        LogRcu::Reclaim();
+        lock.lock();
+    }
+}
+
 KAFKA_NAMESPACE_END
\ No newline at end of file
@@ -19,17 +19,81 @@
 #include <memory>
 #include <list>
 #include <sstream>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 #include "../basic/basicDefine.h"
 #include "../basic/singleton.h"
+#include "../basic/noncopyable.h"
+#include "logBuffer.h"
+#include "dateTimeFormat.h"
+#include "logStream.h"
+#include "logClock.h"
 
 /**
- * @brief
+ * @brief 编译期保留的最低日志级别，低于该级别的日志调用在编译期被整体消除
+ * @details 取值与 LogLevel::Level 相同，如 -DKAFKA_LOG_COMPILE_MIN_LEVEL=2 去掉所有DEBUG日志
+ */
+#ifndef KAFKA_LOG_COMPILE_MIN_LEVEL
+#define KAFKA_LOG_COMPILE_MIN_LEVEL 0
+#endif
+
+/**
+ * @brief 级别是否在编译期保留，为常量表达式
+ */
+#define KAFKA_LOG_LEVEL_ENABLED(level) (static_cast<int>(level) >= KAFKA_LOG_COMPILE_MIN_LEVEL)
+
+/**
+ * @brief 当前调用点的静态描述，第一次执行时构造并登记到 LogSiteRegistry
+ */
+#define KAFKA_LOG_SITE(level, fmt) \
+    [](const char *func, KAFKA::LogLevel::Level l, const char *f) -> KAFKA::LogSite& { \
+        static KAFKA::LogSite s_site(__FILE__, __LINE__, func, l, f); \
+        return s_site; \
+    }(__func__, level, fmt)
+
+/**
+ * @brief 绑定日志器表达式，只求值一次，kafka_log_logger在之后的语句中可用
+ * @details 用两层for限定变量的作用域，宏后面的else仍与外层的if匹配
+ */
+#define KAFKA_LOG_BIND_LOGGER(logger) \
+    for (bool kafka_log_once = true; kafka_log_once;) \
+        for (auto &&kafka_log_logger = (logger); kafka_log_once; kafka_log_once = false)
+
+/**
+ * @brief 调用点只保留级别判断、调用点开关和条件cond，构造事件的代码在cold函数中
+ * @details 用for限定调用点变量的作用域，宏后面的else仍与外层的if匹配。
+ *          logger只求值一次。cond中可以用kafka_log_site访问调用点，不满足时不构造事件，也不计算<<后面的参数。
+ *          开启 LogFlightRecorder 时级别被过滤的日志也构造事件，只写入当前线程的环
+ */
+#define KAFKA_LOG_LEVEL_IF(logger, level, cond) \
+    if (!KAFKA_LOG_LEVEL_ENABLED(level)) {} \
+    else KAFKA_LOG_BIND_LOGGER(logger) \
+    if (KAFKA_LIKELY(kafka_log_logger->getLevel() > level) && KAFKA_LIKELY(!KAFKA::LogFlightRecorder::IsEnabled())) {} \
+    else for (KAFKA::LogSite *kafka_log_site = KAFKA_LOG_SITE(level, "").ifEnabled(); \
+              kafka_log_site && (kafka_log_logger->getLevel() > level || (cond)); kafka_log_site = nullptr) \
+        KAFKA::LogEventWrap(kafka_log_logger, level, *kafka_log_site).getSS()
+
+/**
+ * @brief 调用点只保留级别判断和调用点开关，构造事件的代码在cold函数中
+ */
+#define KAFKA_LOG_LEVEL(logger, level) KAFKA_LOG_LEVEL_IF(logger, level, true)
+
+/**
+ * @brief 同一调用点每n次只输出第1次，之后输出时先补一条被跳过的数量
+ */
+#define KAFKA_LOG_EVERY_N(logger, level, n) KAFKA_LOG_LEVEL_IF(logger, level, kafka_log_site->everyN(n))
+
+/**
+ * @brief 同一调用点每ms毫秒最多输出一次
+ */
+#define KAFKA_LOG_EVERY_MS(logger, level, ms) KAFKA_LOG_LEVEL_IF(logger, level, kafka_log_site->everyMs(ms))
+
+/**
+ * @brief 同一调用点按概率p(0~1)随机输出
  */
-#define KAFKA_LOG_LEVEL(logger, level) \
-    if (logger->getLevel() <= level)  \
-        KAFKA::LogEventWrap(KAFKA::LogEvent::LogEventPtr(new KAFKA::LogEvent(logger, level, \
-                            __FILE__, __LINE__, 0, 1, \
-                            2, time(0), "main"))).getSS()
+#define KAFKA_LOG_SAMPLED(logger, level, p) KAFKA_LOG_LEVEL_IF(logger, level, kafka_log_site->sampled(p))
 
 /**
  * @brief
@@ -58,13 +122,26 @@
 
 /**
  * @brief 使用格式化方式将日志级别level的日志写入到logger中
+ * @details logger设置了二进制日志文件时只记录调用点id和原始参数，由kafka-logdecode离线格式化，
+ *          此时fmt在同一调用点必须是不变的字符串
  */
+#define KAFKA_LOG_FMT_LEVEL(logger, level, fmt, ...) KAFKA_LOG_FMT_LEVEL_IF(logger, level, true, fmt, __VA_ARGS__)
 
-#define KAFKA_LOG_FMT_LEVEL(logger, level, fmt, ...) \
-    if (logger->getLevel() <= level)  \
-        KAFKA::LogEventWrap(KAFKA::LogEvent::LogEventPtr(new KAFKA::LogEvent(logger, level, \
-                            __FILE__, __LINE__, 0, 1, \
-                            2, time(0), "main"))).getEvent()->format(fmt, __VA_ARGS__)
+/**
+ * @brief 满足条件cond时使用格式化方式写入日志，cond同 KAFKA_LOG_LEVEL_IF
+ * @details 开启 LogFlightRecorder 时级别被过滤的日志也编码原始参数写入当前线程的环，
+ *          cond只在级别通过时求值，限流和采样的状态不受被过滤的调用影响
+ */
+#define KAFKA_LOG_FMT_LEVEL_IF(logger, level, cond, fmt, ...) \
+    if (!KAFKA_LOG_LEVEL_ENABLED(level)) {} \
+    else KAFKA_LOG_BIND_LOGGER(logger) \
+    if (KAFKA_LIKELY(kafka_log_logger->getLevel() > level) && KAFKA_LIKELY(!KAFKA::LogFlightRecorder::IsEnabled())) {} \
+    else for (KAFKA::LogSite *kafka_log_site = KAFKA_LOG_SITE(level, fmt).ifEnabled(); \
+              kafka_log_site; kafka_log_site = nullptr) \
+        if (kafka_log_logger->getLevel() > level) \
+            KAFKA::LogFlightRecorder::Record(level, *kafka_log_site, __VA_ARGS__); \
+        else if (!(cond)) {} \
+        else KAFKA::BinaryLog::Format(kafka_log_logger, level, *kafka_log_site, fmt, __VA_ARGS__)
 
 /**
  * @brief
@@ -91,12 +168,34 @@
  */
 #define KAFKA_LOG_FMT_FATAL(logger, fmt, ...) KAFKA_LOG_FMT_LEVEL(logger, KAFKA::LogLevel::FATAL, fmt, __VA_ARGS__)
 
+/**
+ * @brief 格式化方式的 KAFKA_LOG_EVERY_N
+ */
+#define KAFKA_LOG_FMT_EVERY_N(logger, level, n, fmt, ...) \
+    KAFKA_LOG_FMT_LEVEL_IF(logger, level, kafka_log_site->everyN(n), fmt, __VA_ARGS__)
+
+/**
+ * @brief 格式化方式的 KAFKA_LOG_EVERY_MS
+ */
+#define KAFKA_LOG_FMT_EVERY_MS(logger, level, ms, fmt, ...) \
+    KAFKA_LOG_FMT_LEVEL_IF(logger, level, kafka_log_site->everyMs(ms), fmt, __VA_ARGS__)
+
+/**
+ * @brief 格式化方式的 KAFKA_LOG_SAMPLED
+ */
+#define KAFKA_LOG_FMT_SAMPLED(logger, level, p, fmt, ...) \
+    KAFKA_LOG_FMT_LEVEL_IF(logger, level, kafka_log_site->sampled(p), fmt, __VA_ARGS__)
+
 
 KAFKA_NAMESPACE_BEGIN
 
 class Logger;
 class LogAppender;
 class LoggerManager;
+class AsyncLogDispatcher;
+class LogStagingBuffer;
+class BinaryLogWriter;
+class LogDedupFilter;
 
 /**
  * @brief 日志级别
@@ -129,13 +228,112 @@ public:
     static LogLevel::Level fromString(const std::string & str);
 };
 
+/**
+ * @brief KAFKA_LOG_* 调用点的静态描述
+ * @details 每个调用点在第一次执行时构造一次并登记到LogSiteRegistry，分配全局唯一的id。
+ *          日志事件和二进制日志只引用调用点，不再逐条传递文件名、行号等信息。
+ *          每个调用点有独立的开关，可在运行时关闭个别调用点，关闭后只剩一次原子读
+ */
+class LogSite : noncopyable {
+public:
+    /**
+     * @brief
+     * @param file 文件名
+     * @param line 行号
+     * @param function 函数名
+     * @param level 调用点的日志级别
+     * @param format 格式字符串，流式调用点为""
+     */
+    LogSite(const char *file, int32_t line, const char *function, LogLevel::Level level, const char *format);
+
+    uint32_t getId() const {return m_id;}
+
+    const char* getFile() const {return m_file;}
+
+    int32_t getLine() const {return m_line;}
+
+    const char* getFunction() const {return m_function;}
+
+    LogLevel::Level getLevel() const {return m_level;}
+
+    const char* getFormat() const {return m_format;}
+
+    bool isEnabled() const {return m_enabled.load(std::memory_order_relaxed);}
+
+    void setEnabled(bool v) {m_enabled.store(v, std::memory_order_relaxed);}
+
+    /**
+     * @brief 供日志宏使用，开启时返回自身，关闭时返回nullptr
+     */
+    LogSite* ifEnabled() {return KAFKA_LIKELY(isEnabled()) ? this : nullptr;}
+
+    /**
+     * @brief 二进制日志的参数类型，见 BinaryArg，未以二进制方式写入过时为nullptr
+     */
+    const char* getArgTypes() const {return m_argTypes.load(std::memory_order_acquire);}
+
+    void setArgTypes(const char *types) {m_argTypes.store(types, std::memory_order_release);}
+
+    /**
+     * @brief 最近写入过该调用点描述的二进制日志写入器编号，见 BinaryLogWriter
+     */
+    uint32_t getBinaryWriter() const {return m_binaryWriter.load(std::memory_order_acquire);}
+
+    void setBinaryWriter(uint32_t id) {m_binaryWriter.store(id, std::memory_order_release);}
+
+    /**
+     * @brief 限流: 每n次调用通过1次
+     */
+    bool everyN(uint64_t n) {
+        if (m_calls.fetch_add(1, std::memory_order_relaxed) % (n ? n : 1) == 0) {
+            return true;
+        }
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * @brief 限流: 距上次通过超过ms毫秒时通过
+     */
+    bool everyMs(uint64_t ms);
+
+    /**
+     * @brief 采样: 以概率p通过
+     */
+    bool sampled(double p);
+
+    /**
+     * @brief 取出并清零被限流或采样跳过的次数
+     */
+    uint64_t takeSuppressed() {
+        return m_suppressed.load(std::memory_order_relaxed)
+               ? m_suppressed.exchange(0, std::memory_order_relaxed) : 0;
+    }
+
+private:
+    const char *m_file;
+    int32_t m_line;
+    const char *m_function;
+    LogLevel::Level m_level;
+    const char *m_format;
+    uint32_t m_id;
+    std::atomic<bool> m_enabled;
+    std::atomic<const char*> m_argTypes;
+    std::atomic<uint32_t> m_binaryWriter;
+    //限流和采样状态
+    std::atomic<uint64_t> m_calls;
+    std::atomic<uint64_t> m_lastPass;
+    std::atomic<uint64_t> m_suppressed;
+};
+
 /**
  * @brief
  */
 class LogEvent {
+friend class LogEventPool;
 public:
     using LogEventPtr = std::shared_ptr<LogEvent>;
-    LogEvent() = default;
+    LogEvent() {m_ss.setFields(&m_fields);}
 
     /**
      * @brief
@@ -146,12 +344,12 @@ public:
      * @param elapse
      * @param thread_id
      * @param fiber_id
-     * @param time
-     * @param thread_name
+     * @param timestamp LogClock::Now()的时间戳
+     * @param thread_name 线程名称，保存 LogThreadContext::Intern 后的字符串
      */
     LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level,
              const char* file, int32_t line, uint32_t elapse,
-             uint32_t thread_id, uint32_t fiber_id, uint64_t time,
+             uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
              const std::string & thread_name);
 
     /**
@@ -166,6 +364,18 @@ public:
      */
     int32_t getLine() const {return m_line;}
 
+    /**
+     * @brief 产生事件的调用点，不是由日志宏产生时为nullptr
+     * @return
+     */
+    const LogSite* getSite() const {return m_site;}
+
+    /**
+     * @brief
+     * @param site
+     */
+    void setSite(const LogSite *site) {m_site = site;}
+
     /**
      * @brief
      * @return
@@ -185,28 +395,53 @@ public:
     uint32_t getFiberId() const {return m_fiberId;}
 
     /**
-     * @brief
+     * @brief LogClock的单调时间戳(纳秒)，用于排序和计算延迟
      * @return
      */
-    uint64_t getTime() const {return m_time;}
+    uint64_t getTimestamp() const {return m_timestamp;}
 
     /**
-     * @brief
+     * @brief 墙上时间(1970年以来的纳秒数)，未调用setTime时由时间戳换算
+     * @return
+     */
+    uint64_t getWallTime() const {return m_wallTime ? m_wallTime : LogClock::ToWallTime(m_timestamp);}
+
+    /**
+     * @brief 墙上时间的秒数
+     * @return
+     */
+    uint64_t getTime() const {return getWallTime() / 1000000000;}
+
+    /**
+     * @brief 墙上时间秒内的纳秒部分，用于 %d{...%3N} 等亚秒字段
      * @return
      */
-    const std::string& getThreadName() const {return m_threadName;}
+    uint32_t getNanosecond() const {return static_cast<uint32_t>(getWallTime() % 1000000000);}
+
+    /**
+     * @brief 直接设置墙上时间，用于还原已记录的事件
+     * @param sec 秒
+     * @param nsec 秒内的纳秒
+     */
+    void setTime(uint64_t sec, uint32_t nsec) {m_wallTime = sec * 1000000000 + nsec;}
 
     /**
      * @brief
      * @return
      */
-    std::string getContent() const {return m_ss.str();}
+    const std::string& getThreadName() const {return *m_threadName;}
 
     /**
      * @brief
      * @return
      */
-    std::shared_ptr<Logger> getLogger() const {return m_logger;}
+    StringView getContent() const {return m_ss.view();}
+
+    /**
+     * @brief 创建事件的日志器，事件在释放前一直持有它
+     * @return
+     */
+    const std::shared_ptr<Logger>& getLogger() const {return m_logger;}
 
     /**
      * @brief
@@ -218,7 +453,19 @@ public:
      * @brief
      * @return
      */
-    std::stringstream& getSS() {return m_ss;}
+    LogStream& getSS() {return m_ss;}
+
+    /**
+     * @brief 键值字段
+     * @return
+     */
+    const LogFields& getFields() const {return m_fields;}
+
+    /**
+     * @brief 添加键值字段，也可以通过 getSS() << LogField(key, value) 添加
+     * @param field
+     */
+    void addField(const LogField &field) {m_fields.add(field);}
 
     /**
      * @brief
@@ -234,26 +481,44 @@ public:
      */
     void format(const char * fmt, va_list al);
 
+private:
+    /**
+     * @brief 复用事件对象，保留内容缓冲区的空间
+     * @param thread_name 只保存引用，需一直有效
+     */
+    void reset(std::shared_ptr<Logger> logger, LogLevel::Level level,
+               const char* file, int32_t line, uint32_t elapse,
+               uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+               const std::string &thread_name);
+
 private:
     const char* m_file = nullptr;
     //行号
     int32_t m_line = 0;
+    //调用点
+    const LogSite *m_site = nullptr;
     //程序启动到现在的毫秒数
     uint32_t m_elapse = 0;
     //线程ID
     uint32_t m_threadId = 0;
     //协程ID
     uint32_t m_fiberId = 0;
-    //时间戳
-    uint64_t m_time = 0;
-    //线程名称
-    std::string m_threadName;
-    //字符串流
-    std::stringstream m_ss;
+    //LogClock时间戳
+    uint64_t m_timestamp = 0;
+    //setTime设置的墙上时间，为0时由m_timestamp换算
+    uint64_t m_wallTime = 0;
+    //线程名称，指向 LogThreadContext 的名称表
+    const std::string *m_threadName = &s_emptyName;
+    //日志内容
+    LogStream m_ss;
+    //键值字段
+    LogFields m_fields;
     //日志器
     std::shared_ptr<Logger> m_logger;
     //日志等级
     LogLevel::Level m_level;
+
+    static const std::string s_emptyName;
 };
 
 class LogEventWrap {
@@ -264,6 +529,21 @@ public:
      */
     explicit LogEventWrap(LogEvent::LogEventPtr event);
 
+    /**
+     * @brief 从对象池获取事件，供日志宏使用，编译为cold函数
+     * @details 文件名和行号取自调用点，线程信息和启动时间取自 LogThreadContext
+     */
+    KAFKA_COLD LogEventWrap(const std::shared_ptr<Logger> &logger, LogLevel::Level level, LogSite &site);
+
+    /**
+     * @brief 从对象池获取事件
+     * @details 文件名和行号取自调用点，其余参数与 LogEventPool::Acquire 相同
+     */
+    LogEventWrap(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                 LogSite &site, uint32_t elapse,
+                 uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+                 const std::string &thread_name);
+
     /**
      * @brief
      */
@@ -279,66 +559,164 @@ public:
      * @brief
      * @return
      */
-    std::stringstream& getSS();
+    LogStream& getSS();
+
+    /**
+     * @brief 构造事件并按printf格式写入内容后输出，供KAFKA_LOG_FMT_*使用，编译为cold函数
+     */
+    KAFKA_COLD static void Format(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                                  LogSite &site, const char *fmt, ...);
+private:
+    void init(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+              LogSite &site, uint32_t elapse,
+              uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+              const std::string &thread_name);
+
 private:
     LogEvent::LogEventPtr m_event;
 };
 
+/**
+ * @brief 日志事件对象池
+ * @details 每个线程维护空闲事件列表，事件连同其内容缓冲区、shared_ptr控制块一起复用，
+ *          稳定状态下写一条日志不再申请堆内存。事件在哪个线程释放就回到哪个线程的空闲列表
+ */
+class LogEventPool {
+public:
+    /**
+     * @brief 获取一个日志事件，参数与LogEvent构造函数相同
+     * @details thread_name只保存引用，需一直有效，一般为 LogThreadContext 中的线程名称
+     */
+    static LogEvent::LogEventPtr Acquire(std::shared_ptr<Logger> logger, LogLevel::Level level,
+                                         const char* file, int32_t line, uint32_t elapse,
+                                         uint32_t thread_id, uint32_t fiber_id, uint64_t timestamp,
+                                         const std::string &thread_name);
+
+private:
+    /**
+     * @brief 事件引用计数归零时回收
+     */
+    static void Release(LogEvent *event);
+};
+
 class LogFormatter {
 public:
     typedef std::shared_ptr<LogFormatter> LogFormatterPtr;
 
     explicit LogFormatter(const std::string &pattern);
 
+    virtual ~LogFormatter() = default;
+
     std::string format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event);
 
     std::ostream& format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event);
 
     /**
-     * @brief generate format
+     * @brief 格式化日志，直接追加到调用方提供的缓冲区
+     * @param buf 输出缓冲区
+     * @param logger 日志器
+     * @param level 日志级别
+     * @param event 日志事件
      */
-public:
-    class FormatItem {
-    public:
-        typedef std::shared_ptr<FormatItem> FormatItemPtr;
-
-        /**
-         * @brief
-         */
-        virtual ~FormatItem() = default;
-
-        /**
-         * @brief
-         * @param os 输出流
-         * @param logger 日志
-         * @param level
-         * @param event
-         */
-        virtual void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event) = 0;
-    };
+    virtual void format(LogBuffer &buf, const std::shared_ptr<Logger> &logger, LogLevel::Level level, const LogEvent::LogEventPtr &event);
 
     void init();
 
     bool isError() const {return m_error;}
 
     const std::string getPattern() const {return m_pattern;}
+protected:
+    /**
+     * @brief 供编译期格式化器使用，不解析pattern
+     */
+    LogFormatter() = default;
+
 private:
+    /**
+     * @brief pattern解析后的操作码，与%xxx一一对应
+     */
+    enum OpCode {
+        OP_LITERAL = 0,
+        OP_MESSAGE,
+        OP_LEVEL,
+        OP_ELAPSE,
+        OP_NAME,
+        OP_THREAD_ID,
+        OP_NEWLINE,
+        OP_DATETIME,
+        OP_FILENAME,
+        OP_LINE,
+        OP_TAB,
+        OP_FIBER_ID,
+        OP_THREAD_NAME
+    };
+
+    struct Op {
+        uint8_t code;
+        //普通字符串为其在m_literals中的位置，时间为m_dateFormats的下标
+        uint32_t offset;
+        uint32_t len;
+    };
+
+    void addOp(uint8_t code, const std::string &arg);
+
+protected:
     std::string m_pattern;
+private:
     bool m_error = false;
-    std::vector<FormatItem::FormatItemPtr> m_items;
+    std::vector<Op> m_ops;
+    std::string m_literals;
+    std::vector<DateTimeFormat> m_dateFormats;
+};
 
+/**
+ * @brief 输出目标的刷新策略，满足任一条件时将缓冲的日志写出
+ */
+struct FlushPolicy {
+    //缓冲超过该字节数
+    size_t bytes = 64 * 1024;
+    //距上次写出超过该毫秒数，由LoggerManager的定时线程检查，为0时不按时间写出
+    uint32_t interval = 1000;
+    //日志级别不低于该级别时立即写出
+    LogLevel::Level level = LogLevel::ERROR;
+    //收到致命信号时写出，需先调用LoggerManager::installFlushSignalHandler，在首次写入或安装时生效
+    bool onSignal = true;
 };
 
-class LogAppender {
+/**
+ * @brief 日志输出目标
+ * @details Logger::doLog 不经过log()，而是调用logDirect，不支持时格式化后调用logFormatted，
+ *          子类通过覆盖logDirect、logFormatted、writeBuffer和flushBuffer改变输出方式
+ */
+class LogAppender : public std::enable_shared_from_this<LogAppender> {
+friend class LogStagingBuffer;
 public:
     typedef std::shared_ptr<LogAppender> LogAppenderPtr;
 
     /**
-     * @brief
+     * @brief 格式化日志并写入输出目标，不在Logger的输出路径上，子类不能覆盖
      * @param level
      * @param event
      */
-    virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event) = 0;
+    void log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::LogEventPtr event);
+
+    /**
+     * @brief 写入已格式化的日志，Logger对使用同一格式器的appender只格式化一次，再分别调用该函数
+     * @param level
+     * @param data
+     * @param len
+     */
+    virtual void logFormatted(LogLevel::Level level, const char *data, size_t len);
+
+    /**
+     * @brief 由格式器直接写入输出目标自己的缓冲区，省去中间缓冲区和一次拷贝
+     * @param logger
+     * @param level
+     * @param event
+     * @return 不支持时返回false，由调用方格式化后调用logFormatted
+     */
+    virtual bool logDirect(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                           const LogEvent::LogEventPtr &event) {return false;}
 
     /**
      * @brief
@@ -367,24 +745,170 @@ public:
      */
     virtual std::string toYamlString() = 0;
 
+    /**
+     * @brief 是否先写入当前线程的暂存缓冲区，按大小或定时批量交给输出目标
+     * @param v
+     */
+    void setStaging(bool v) {m_staging.store(v, std::memory_order_relaxed);}
+
+    /**
+     * @brief
+     * @return
+     */
+    bool isStaging() const {return m_staging.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 将缓冲的日志写出，开启暂存时先交出当前线程暂存的日志
+     */
+    virtual void flush();
+
+    /**
+     * @brief 设置刷新策略
+     * @param policy
+     */
+    void setFlushPolicy(const FlushPolicy &policy);
+
+    FlushPolicy getFlushPolicy();
+
+protected:
+    /**
+     * @brief 写入格式化后的日志，开启暂存时写入当前线程的暂存缓冲区
+     * @param data
+     * @param len
+     */
+    void append(const char *data, size_t len);
+
+    /**
+     * @brief 将一批格式化后的日志写入输出目标，调用时已持有m_mutex
+     * @param data
+     * @param len
+     */
+    virtual void writeBuffer(const char *data, size_t len) = 0;
+
+    /**
+     * @brief 写出缓冲的日志，调用时已持有m_mutex，默认没有缓冲
+     */
+    virtual void flushBuffer() {}
+
 public:
+    //由m_mutex保护
     bool m_hasFormatter = false;
 
+    //输出线程不加锁读取
+    std::atomic<bool> m_staging{false};
+
     LogLevel::Level m_level = LogLevel::DEBUG;
 
+    //由m_mutex保护，Logger输出时使用其快照中保存的副本
     LogFormatter::LogFormatterPtr m_formatter;
+
+    //每次设置格式器时加1，与Logger快照中保存的版本不同时说明快照中的格式器已过期
+    std::atomic<uint32_t> m_formatterVersion{0};
+
+    //刷新策略，由m_mutex保护
+    FlushPolicy m_flushPolicy;
+
+    //m_flushPolicy.level的副本，供不持有m_mutex的logFormatted读取
+    std::atomic<int> m_flushLevel{LogLevel::ERROR};
+
+    //m_flushPolicy.onSignal的副本，供不持有m_mutex的LoggerManager读取
+    std::atomic<bool> m_flushOnSignal{true};
+
+    //保护输出目标
+    mutable std::mutex m_mutex;
+};
+
+/**
+ * @brief 带用户态缓冲的输出目标，按FlushPolicy批量写出，避免每条日志一次系统调用
+ * @details 子类实现writeOutput完成实际写入，析构时需自行调用flushBuffer()，基类析构时子类已不可用
+ */
+class BufferedLogAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<BufferedLogAppender> BufferedLogAppenderPtr;
+
+    BufferedLogAppender() : m_signalBusy(false) {}
+
+    /**
+     * @brief 由定时线程调用，距上次写出超过策略的间隔时写出
+     * @param now 当前时间(steady_clock毫秒)
+     */
+    void flushIfDue(uint64_t now);
+
+    /**
+     * @brief 致命信号处理中调用，不加锁，缓冲区正在修改时放弃，直接write到输出的文件描述符
+     */
+    void flushForSignal();
+
+    /**
+     * @brief 未开启暂存时在m_mutex内直接格式化到m_buffer
+     */
+    bool logDirect(const std::shared_ptr<Logger> &logger, LogLevel::Level level,
+                   const LogEvent::LogEventPtr &event) override;
+
+protected:
+    void writeBuffer(const char *data, size_t len) override;
+
+    void flushBuffer() override;
+
+    /**
+     * @brief 写入输出目标，调用时已持有m_mutex
+     * @param data
+     * @param len
+     */
+    virtual void writeOutput(const char *data, size_t len) = 0;
+
+    /**
+     * @brief 致命信号处理中写出使用的文件描述符，小于0时不写出
+     */
+    virtual int getOutputFd() const {return -1;}
+
+    /**
+     * @brief 修改m_buffer或输出文件期间置位m_signalBusy，信号处理函数看到置位时不写出
+     * @details 在m_mutex内使用，只会与信号处理函数竞争
+     */
+    class SignalGuard {
+    public:
+        explicit SignalGuard(std::atomic<bool> &busy) : m_busy(busy) {
+            while (m_busy.exchange(true, std::memory_order_acquire)) {
+            }
+        }
+
+        ~SignalGuard() {m_busy.store(false, std::memory_order_release);}
+
+    private:
+        std::atomic<bool> &m_busy;
+    };
+
+    std::atomic<bool> m_signalBusy;
+
+private:
+    /**
+     * @brief 首次写入时登记到LoggerManager的定时刷新，需持有m_mutex
+     */
+    void registerFlush();
+
+private:
+    LogBuffer m_buffer;
+    uint64_t m_lastFlush = 0;
+    //是否已登记到LoggerManager的定时刷新
+    bool m_registered = false;
 };
 
 class Logger : public std::enable_shared_from_this<Logger> {
 public:
     typedef std::shared_ptr<Logger> LoggerPtr;
 
+    //一条日志最多共享格式化结果的不同格式器数，超出的appender各自格式化
+    static const size_t kMaxSharedFormatters = 4;
+
     /**
      * @brief
      * @param name
      */
     explicit Logger(const std::string &name = "root");
 
+    ~Logger();
+
     /**
      * @brief
      * @param level
@@ -392,6 +916,13 @@ public:
      */
     void log (LogLevel::Level level, const LogEvent::LogEventPtr & event);
 
+    /**
+     * @brief 在当前线程调用appender输出，不经过分发器
+     * @param level
+     * @param event
+     */
+    void doLog(LogLevel::Level level, const LogEvent::LogEventPtr & event);
+
     /**
      * @brief
      * @param event
@@ -487,6 +1018,48 @@ public:
      */
     void setRootLogger(const Logger::LoggerPtr root) {m_root = root;}
 
+    /**
+     * @brief 设置异步分发器，设置后appender在分发器的消费线程上调用，为空时同步输出
+     * @param dispatcher
+     */
+    void setDispatcher(std::shared_ptr<AsyncLogDispatcher> dispatcher);
+
+    /**
+     * @brief
+     * @return
+     */
+    std::shared_ptr<AsyncLogDispatcher> getDispatcher();
+
+    /**
+     * @brief 设置二进制日志文件，设置后KAFKA_LOG_FMT_*写入二进制记录，不再经过appender
+     * @param filename 文件名，为空时关闭二进制日志
+     */
+    void setBinaryLogFile(const std::string &filename);
+
+    /**
+     * @brief
+     * @return 二进制日志写入器，未设置时为空
+     */
+    std::shared_ptr<BinaryLogWriter> getBinaryWriter() const {return std::atomic_load(&m_binaryWriter);}
+
+    /**
+     * @brief 开启重复日志折叠，见 LogDedupFilter
+     * @param window 窗口长度(毫秒)，为0时关闭
+     */
+    void setDedupWindow(uint32_t window);
+
+    /**
+     * @brief
+     * @return 重复日志折叠，未开启时为空
+     */
+    std::shared_ptr<LogDedupFilter> getDedupFilter() const {return std::atomic_load(&m_dedup);}
+
+    /**
+     * @brief 折叠窗口已结束时补输出汇总，由LoggerManager的定时线程调用
+     * @param now 当前时间(steady_clock毫秒)
+     */
+    void expireDedup(uint64_t now);
+
     /**
      * @brief
      * @return
@@ -497,27 +1070,69 @@ private:
     LogLevel::Level m_level;
     //日志名称
     std::string m_name;
-    //日志输出目标集合
-    std::list<LogAppender::LogAppenderPtr> m_appenders;
+    /**
+     * @brief 输出目标集合快照中的一项，格式器在发布快照时固定
+     */
+    struct AppenderEntry {
+        LogAppender::LogAppenderPtr appender;
+        //发布快照时appender的格式器
+        LogFormatter::LogFormatterPtr formatter;
+        //发布快照时appender格式器的版本
+        uint32_t version;
+        //快照中是否有其他appender使用同一格式器，没有时可直接格式化到appender的缓冲区
+        bool shared;
+    };
+    typedef std::vector<AppenderEntry> AppenderList;
+
+    /**
+     * @brief 按appender当前的格式器生成快照并发布，需持有m_appenderMutex
+     * @return 被替换的快照，由调用方释放m_appenderMutex后交给LogRcu::Retire
+     */
+    const AppenderList* publishAppenders(const std::vector<LogAppender::LogAppenderPtr> &appenders);
+
+    /**
+     * @brief 交给分发器或在当前线程输出
+     */
+    void output(LogLevel::Level level, const LogEvent::LogEventPtr &event);
+
+    //日志输出目标集合的快照，发布后不再修改，输出时在 LogRcu 读临界区内读取，不加锁。
+    //被替换的快照交给LogRcu，在读到它的线程都离开临界区后释放
+    std::atomic<const AppenderList*> m_appenders;
+    //修改输出目标集合、格式器时加锁
+    std::mutex m_appenderMutex;
     //主日志器
     Logger::LoggerPtr m_root;
     //
     LogFormatter::LogFormatterPtr m_formatter;
-
+    //异步分发器，输出时在 LogRcu 读临界区内读取裸指针，由m_dispatcherOwner持有，修改时加m_appenderMutex
+    std::atomic<AsyncLogDispatcher*> m_dispatcher;
+    std::shared_ptr<AsyncLogDispatcher> m_dispatcherOwner;
+    //二进制日志，只通过atomic_load/atomic_store访问
+    std::shared_ptr<BinaryLogWriter> m_binaryWriter;
+    //重复日志折叠，只通过atomic_load/atomic_store访问，m_hasDedup用于未开启时跳过atomic_load
+    std::shared_ptr<LogDedupFilter> m_dedup;
+    std::atomic<bool> m_hasDedup;
+    //是否已登记到LoggerManager的定时检查
+    std::atomic<bool> m_dedupRegistered;
 
 };
 
-class StdoutLogAppender : public LogAppender {
+class StdoutLogAppender : public BufferedLogAppender {
 public:
     typedef std::shared_ptr<StdoutLogAppender> StdoutLogAppenderPtr;
 
-    void log(Logger::LoggerPtr logger, LogLevel::Level level, LogEvent::LogEventPtr event) override;
+    ~StdoutLogAppender() override;
 
     std::string toYamlString() override;
 
+protected:
+    void writeOutput(const char *data, size_t len) override;
+
+    int getOutputFd() const override;
+
 };
 
-class FileLogAppender : public LogAppender{
+class FileLogAppender : public BufferedLogAppender {
 public:
     typedef std::shared_ptr<FileLogAppender> FileLogAppenderPtr;
 
@@ -529,18 +1144,74 @@ public:
 
     ~FileLogAppender() override;
 
-    void log(Logger::LoggerPtr logger, LogLevel::Level level, LogEvent::LogEventPtr event) override;
-
     std::string toYamlString() override;
 
     bool reopen();
 
+protected:
+    void writeOutput(const char *data, size_t len) override;
+
+    int getOutputFd() const override {return m_fd;}
+
 private:
     std::string m_filename;
-    std::ofstream m_filestream;
+    int m_fd = -1;
     uint64_t m_lastTime = 0;
 };
 
+class AsyncLogWriter;
+
+class AsyncFileLogAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<AsyncFileLogAppender> AsyncFileLogAppenderPtr;
+
+    /**
+     * @brief 异步文件输出，格式化在调用线程完成，文件IO由后台线程批量完成
+     * @param filename 文件名
+     * @param flushInterval 后台线程最长写入间隔(秒)
+     */
+    explicit AsyncFileLogAppender(const std::string &filename, int flushInterval = 3);
+
+    ~AsyncFileLogAppender() override;
+
+    std::string toYamlString() override;
+
+    void reopen();
+
+protected:
+    void writeBuffer(const char *data, size_t len) override;
+
+private:
+    std::string m_filename;
+    std::unique_ptr<AsyncLogWriter> m_writer;
+};
+
+/**
+ * @brief 日志器句柄，供调用点缓存
+ * @details 只保存裸指针，使用时不修改引用计数。日志器注册后不会从LoggerManager中删除，
+ *          句柄在LoggerManager析构前一直有效。可以直接传给KAFKA_LOG_*宏
+ */
+class LoggerHandle {
+public:
+    LoggerHandle() : m_logger(nullptr) {}
+
+    explicit LoggerHandle(Logger *logger) : m_logger(logger) {}
+
+    Logger* operator->() const {return m_logger;}
+
+    Logger* get() const {return m_logger;}
+
+    explicit operator bool() const {return m_logger != nullptr;}
+
+    /**
+     * @brief 需要shared_ptr的地方(如日志事件)按需转换
+     */
+    operator Logger::LoggerPtr() const {return m_logger ? m_logger->shared_from_this() : Logger::LoggerPtr();}
+
+private:
+    Logger *m_logger;
+};
+
 class LoggerManager {
 public:
     /**
@@ -550,10 +1221,22 @@ public:
 
     /**
      * @brief
+     */
+    ~LoggerManager();
+
+    /**
+     * @brief
+     * @param name
+     * @return
+     */
+    Logger::LoggerPtr getLogger(const std::string &name);
+
+    /**
+     * @brief 获取日志器句柄，不存在时创建
      * @param name
      * @return
      */
-    Logger::LoggerPtr getLogger(const std::string name);
+    LoggerHandle getLoggerHandle(const std::string &name) {return LoggerHandle(getLogger(name).get());}
 
     /**
      * @brief
@@ -571,13 +1254,134 @@ public:
      */
      std::string toYamlString();
 
+    /**
+     * @brief 登记线程暂存缓冲区，由定时线程周期性刷新
+     * @param buffer
+     */
+    void addStagingBuffer(const std::shared_ptr<LogStagingBuffer> &buffer);
+
+    /**
+     * @brief 线程退出时注销暂存缓冲区
+     * @param buffer
+     */
+    void delStagingBuffer(const std::shared_ptr<LogStagingBuffer> &buffer);
+
+    /**
+     * @brief 刷新所有线程的暂存缓冲区
+     */
+    void flushStagingBuffers();
+
+    /**
+     * @brief 暂存缓冲区超过该字节数时立即交给输出目标
+     */
+    size_t getStagingThreshold() const {return m_stagingThreshold.load(std::memory_order_relaxed);}
+
+    void setStagingThreshold(size_t v) {m_stagingThreshold = v;}
+
+    /**
+     * @brief 定时刷新间隔(毫秒)
+     */
+    uint32_t getStagingInterval() const {return m_stagingInterval.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 修改刷新间隔，定时线程按新的间隔重新等待
+     */
+    void setStagingInterval(uint32_t v);
+
+    /**
+     * @brief 登记带缓冲的输出目标，由定时线程按其刷新策略写出，进程退出时全部写出
+     * @param appender
+     */
+    void addFlushAppender(const std::shared_ptr<BufferedLogAppender> &appender);
+
+    /**
+     * @brief 写出已登记的输出目标
+     * @param force 为true时忽略刷新间隔
+     */
+    void flushAppenders(bool force);
+
+    /**
+     * @brief 登记开启了重复日志折叠的日志器，由定时线程补输出汇总
+     * @param logger
+     */
+    void addDedupLogger(const Logger::LoggerPtr &logger);
+
+    /**
+     * @brief 检查已登记日志器的折叠窗口
+     * @param now 当前时间(steady_clock毫秒)
+     */
+    void expireDedupLoggers(uint64_t now);
+
+    /**
+     * @brief 安装SIGSEGV、SIGBUS、SIGFPE、SIGILL、SIGABRT的处理函数，
+     *        先写出策略开启了onSignal的输出目标，再按默认方式处理信号
+     * @details 安装后开启onSignal的输出目标由LoggerManager持有到进程退出，信号处理函数只访问其裸指针
+     */
+    void installFlushSignalHandler();
+
+private:
+    /**
+     * @brief 致命信号处理函数
+     */
+    static void FlushSignalHandler(int sig);
+
+    /**
+     * @brief 登记信号处理函数中写出的输出目标，需持有m_stagingMutex
+     */
+    void addSignalAppender(const std::shared_ptr<BufferedLogAppender> &appender);
+
 private:
-    std::unordered_map<std::string, Logger::LoggerPtr> m_loggers;
+    /**
+     * @brief 暂存缓冲区定时刷新线程
+     */
+    void stagingThreadFunc();
+
+private:
+    typedef std::unordered_map<std::string, Logger::LoggerPtr> LoggerMap;
+
+    //日志器注册表的分片数
+    static const size_t kLoggerShards = 16;
+
+    /**
+     * @brief 注册表分片
+     * @details 查找在 LogRcu 读临界区内读取当前发布的快照，不加锁；创建时在分片锁内复制快照、插入后重新发布。
+     *          旧快照交给LogRcu，在并发的查找都离开临界区后释放
+     */
+    struct LoggerShard {
+        std::mutex mutex;
+        std::atomic<const LoggerMap*> snapshot;
+    };
+
+    LoggerShard& getShard(const std::string &name) {return m_shards[std::hash<std::string>()(name) % kLoggerShards];}
+
+private:
+    LoggerShard m_shards[kLoggerShards];
     Logger::LoggerPtr m_root;
+    //线程暂存缓冲区
+    std::vector<std::shared_ptr<LogStagingBuffer>> m_stagingBuffers;
+    //带缓冲的输出目标，与暂存缓冲区由同一个定时线程刷新
+    std::vector<std::weak_ptr<BufferedLogAppender>> m_flushAppenders;
+    //开启了重复日志折叠的日志器
+    std::vector<std::weak_ptr<Logger>> m_dedupLoggers;
+    //信号处理函数中写出的输出目标，由m_signalOwners持有，信号处理函数只读取前m_signalCount个裸指针
+    static const size_t kMaxSignalAppenders = 64;
+    BufferedLogAppender *m_signalAppenders[kMaxSignalAppenders];
+    std::atomic<size_t> m_signalCount;
+    std::vector<std::shared_ptr<BufferedLogAppender>> m_signalOwners;
+    bool m_signalInstalled = false;
+    std::mutex m_stagingMutex;
+    std::condition_variable m_stagingCond;
+    std::thread m_stagingThread;
+    bool m_stagingRunning = false;
+    std::atomic<size_t> m_stagingThreshold;
+    std::atomic<uint32_t> m_stagingInterval;
 };
 
 //日志管理类的单例模式
 typedef KAFKA::Singleton<LoggerManager> LoggerMgr;
 
 KAFKA_NAMESPACE_END
+
+#include "binaryLog.h"
+
 #endif //KAFKA_LOG_H
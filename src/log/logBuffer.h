@@ -0,0 +1,212 @@
+/**
+ * @file logBuffer.h
+ * @brief 日志缓冲区
+ * @author ziv
+ * @email
+ * @date 22-11-3.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGBUFFER_H
+#define KAFKA_LOGBUFFER_H
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+//小缓冲区大小，用于单条日志
+const size_t kSmallBuffer = 4000;
+//大缓冲区大小，用于异步日志批量写入
+const size_t kLargeBuffer = 4000 * 1000;
+
+/**
+ * @brief 定长缓冲区，空间不足时不写入
+ * @tparam SIZE 缓冲区大小
+ */
+template<size_t SIZE>
+class FixedBuffer : noncopyable {
+public:
+    FixedBuffer() : m_cur(m_data) {}
+
+    /**
+     * @brief 追加数据，剩余空间不足时丢弃
+     * @param buf 数据
+     * @param len 长度
+     * @return 是否写入成功
+     */
+    bool append(const char *buf, size_t len) {
+        if (avail() < len) {
+            return false;
+        }
+        memcpy(m_cur, buf, len);
+        m_cur += len;
+        return true;
+    }
+
+    const char* data() const {return m_data;}
+
+    size_t length() const {return static_cast<size_t>(m_cur - m_data);}
+
+    size_t avail() const {return static_cast<size_t>(end() - m_cur);}
+
+    bool empty() const {return m_cur == m_data;}
+
+    void reset() {m_cur = m_data;}
+
+    std::string toString() const {return std::string(m_data, length());}
+
+private:
+    const char* end() const {return m_data + sizeof(m_data);}
+
+private:
+    char m_data[SIZE];
+    char* m_cur;
+};
+
+/**
+ * @brief 将无符号整数转换为十进制字符串，每次处理两位
+ * @param buf 输出位置，至少20字节
+ * @param value
+ * @return 写入的字节数
+ */
+inline size_t formatUInt(char *buf, uint64_t value) {
+    static const char s_digits[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while (value >= 100) {
+        unsigned idx = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+        *--p = s_digits[idx + 1];
+        *--p = s_digits[idx];
+    }
+    if (value < 10) {
+        *--p = static_cast<char>('0' + value);
+    }
+    else {
+        unsigned idx = static_cast<unsigned>(value) * 2;
+        *--p = s_digits[idx + 1];
+        *--p = s_digits[idx];
+    }
+    size_t len = static_cast<size_t>(tmp + sizeof(tmp) - p);
+    memcpy(buf, p, len);
+    return len;
+}
+
+/**
+ * @brief 可增长缓冲区，小于N字节时使用内部存储，超过后转移到堆上
+ * @tparam N 内部存储大小
+ */
+template<size_t N>
+class InlineBuffer : noncopyable {
+public:
+    InlineBuffer() : m_data(m_inline), m_size(0), m_capacity(N) {}
+
+    ~InlineBuffer() {
+        if (m_data != m_inline) {
+            free(m_data);
+        }
+    }
+
+    /**
+     * @brief 预留至少n字节的可写空间
+     * @param n
+     * @return 可写位置，写完后调用commit
+     */
+    char* reserve(size_t n) {
+        if (m_capacity - m_size < n) {
+            grow(n);
+        }
+        return m_data + m_size;
+    }
+
+    /**
+     * @brief 确认reserve之后写入的字节数
+     * @param n
+     */
+    void commit(size_t n) {m_size += n;}
+
+    void append(const char *data, size_t len) {
+        memcpy(reserve(len), data, len);
+        m_size += len;
+    }
+
+    void append(const std::string &str) {append(str.c_str(), str.size());}
+
+    void append(const char *str) {append(str, strlen(str));}
+
+    void append(char c) {
+        *reserve(1) = c;
+        ++m_size;
+    }
+
+    void appendUInt(uint64_t value) {
+        m_size += formatUInt(reserve(20), value);
+    }
+
+    void appendInt(int64_t value) {
+        char *p = reserve(21);
+        if (value < 0) {
+            *p++ = '-';
+            m_size += 1 + formatUInt(p, 0 - static_cast<uint64_t>(value));
+        }
+        else {
+            m_size += formatUInt(p, static_cast<uint64_t>(value));
+        }
+    }
+
+    const char* data() const {return m_data;}
+
+    size_t size() const {return m_size;}
+
+    /**
+     * @brief 不扩容时剩余的可写空间
+     */
+    size_t avail() const {return m_capacity - m_size;}
+
+    bool empty() const {return m_size == 0;}
+
+    /**
+     * @brief 清空内容，保留已分配的空间
+     */
+    void clear() {m_size = 0;}
+
+    std::string toString() const {return std::string(m_data, m_size);}
+
+private:
+    void grow(size_t n) {
+        size_t capacity = m_capacity * 2;
+        while (capacity - m_size < n) {
+            capacity *= 2;
+        }
+        char *data = static_cast<char*>(malloc(capacity));
+        memcpy(data, m_data, m_size);
+        if (m_data != m_inline) {
+            free(m_data);
+        }
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+private:
+    char *m_data;
+    size_t m_size;
+    size_t m_capacity;
+    char m_inline[N];
+};
+
+//格式化用的缓冲区
+typedef InlineBuffer<kSmallBuffer> LogBuffer;
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGBUFFER_H
@@ -0,0 +1,141 @@
+/**
+ * @file logClock.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logClock.h"
+#include <time.h>
+#include <mutex>
+#ifdef KAFKA_LOG_CLOCK_TSC
+#include <cpuid.h>
+#endif
+
+KAFKA_NAMESPACE_BEGIN
+
+bool LogClock::s_tsc = false;
+std::atomic<uint32_t> LogClock::s_seq{0};
+std::atomic<uint64_t> LogClock::s_baseTsc{0};
+std::atomic<uint64_t> LogClock::s_baseNs{0};
+std::atomic<uint64_t> LogClock::s_mult{0};
+std::atomic<int64_t> LogClock::s_wallOffset{0};
+
+namespace {
+
+uint64_t readClock(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//时钟的起点
+uint64_t s_startMonotonic = 0;
+uint64_t s_startCoarse = 0;
+//第一次校准的起点，之后的校准都从这里开始计算
+uint64_t s_calibrationTsc = 0;
+uint64_t s_calibrationNs = 0;
+//上次校准的时间
+uint64_t s_lastCalibration = 0;
+std::mutex s_calibrationMutex;
+
+#ifdef KAFKA_LOG_CLOCK_TSC
+/**
+ * @brief CPU是否支持不变TSC(频率恒定，深度睡眠时不停止)
+ */
+bool hasInvariantTsc() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return edx & (1u << 8);
+}
+
+/**
+ * @brief 同时读取TSC和单调时钟，取间隔最短的一次
+ */
+void readPair(uint64_t &tsc, uint64_t &ns) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t before = __rdtsc();
+        uint64_t now = readClock(CLOCK_MONOTONIC);
+        uint64_t after = __rdtsc();
+        if (after - before < best) {
+            best = after - before;
+            tsc = before + (after - before) / 2;
+            ns = now;
+        }
+    }
+}
+#endif
+
+}
+
+/**
+ * @brief 库加载时初始化，先于其他静态对象的构造
+ */
+struct LogClockInit {
+    static void init() {
+        s_startMonotonic = readClock(CLOCK_MONOTONIC);
+        s_startCoarse = readClock(CLOCK_MONOTONIC_COARSE);
+#ifdef KAFKA_LOG_CLOCK_TSC
+        if (hasInvariantTsc()) {
+            uint64_t tsc0 = 0, ns0 = 0, tsc1 = 0, ns1 = 0;
+            readPair(tsc0, ns0);
+            do {
+                readPair(tsc1, ns1);
+            } while (ns1 - ns0 < 2000000);
+            if (tsc1 > tsc0) {
+                s_calibrationTsc = tsc0;
+                s_calibrationNs = ns0;
+                s_lastCalibration = ns1;
+                LogClock::s_baseTsc.store(tsc1, std::memory_order_relaxed);
+                LogClock::s_baseNs.store(ns1 - s_startMonotonic, std::memory_order_relaxed);
+                LogClock::s_mult.store(static_cast<uint64_t>((static_cast<unsigned __int128>(ns1 - ns0) << 32)
+                                                             / (tsc1 - tsc0)), std::memory_order_relaxed);
+                LogClock::s_tsc = true;
+            }
+        }
+#endif
+        LogClock::s_wallOffset.store(static_cast<int64_t>(readClock(CLOCK_REALTIME) - LogClock::Now()),
+                                     std::memory_order_relaxed);
+    }
+};
+
+__attribute__((constructor(101))) static void initLogClock() {
+    LogClockInit::init();
+}
+
+uint64_t LogClock::CoarseNow() {
+    return readClock(CLOCK_MONOTONIC_COARSE) - s_startCoarse;
+}
+
+void LogClock::Recalibrate(uint32_t minInterval) {
+    std::lock_guard<std::mutex> lock(s_calibrationMutex);
+#ifdef KAFKA_LOG_CLOCK_TSC
+    if (s_tsc) {
+        uint64_t tsc = 0, ns = 0;
+        readPair(tsc, ns);
+        if (ns - s_lastCalibration < static_cast<uint64_t>(minInterval) * 1000000) {
+            return;
+        }
+        s_lastCalibration = ns;
+        //从当前值继续，只修正之后的频率，保证单调
+        uint64_t now = Now();
+        uint64_t mult = static_cast<uint64_t>((static_cast<unsigned __int128>(ns - s_calibrationNs) << 32)
+                                              / (tsc - s_calibrationTsc));
+        s_seq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s_baseTsc.store(tsc, std::memory_order_relaxed);
+        s_baseNs.store(now, std::memory_order_relaxed);
+        s_mult.store(mult, std::memory_order_relaxed);
+        s_seq.fetch_add(1, std::memory_order_release);
+    }
+#endif
+    s_wallOffset.store(static_cast<int64_t>(readClock(CLOCK_REALTIME) - Now()), std::memory_order_relaxed);
+}
+
+KAFKA_NAMESPACE_END
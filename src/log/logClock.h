@@ -0,0 +1,97 @@
+/**
+ * @file logClock.h
+ * @brief 日志时间戳使用的低开销时钟
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGCLOCK_H
+#define KAFKA_LOGCLOCK_H
+
+#include <stdint.h>
+#include <atomic>
+#include "../basic/basicDefine.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define KAFKA_LOG_CLOCK_TSC 1
+#endif
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 单调时钟，返回时钟初始化(进程启动)以来的纳秒数
+ * @details CPU支持不变TSC时读取rdtsc并按校准的频率换算，否则使用CLOCK_MONOTONIC_COARSE。
+ *          库加载时用约2ms校准频率，之后 Recalibrate 用更长的区间修正频率并更新与墙上时间的差值，
+ *          LoggerManager的定时线程会定期调用。
+ *          事件只保存该时间戳，格式化或离线解码时才用 ToWallTime 换算为墙上时间
+ */
+class LogClock {
+public:
+    static uint64_t Now() {
+#ifdef KAFKA_LOG_CLOCK_TSC
+        if (KAFKA_LIKELY(s_tsc)) {
+            for (;;) {
+                uint32_t seq = s_seq.load(std::memory_order_acquire);
+                uint64_t baseTsc = s_baseTsc.load(std::memory_order_relaxed);
+                uint64_t baseNs = s_baseNs.load(std::memory_order_relaxed);
+                uint64_t mult = s_mult.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (KAFKA_LIKELY(!(seq & 1) && seq == s_seq.load(std::memory_order_relaxed))) {
+                    return baseNs + Scale(__rdtsc() - baseTsc, mult);
+                }
+            }
+        }
+#endif
+        return CoarseNow();
+    }
+
+    /**
+     * @brief 换算为墙上时间
+     * @param timestamp Now()的返回值
+     * @return 1970年以来的纳秒数
+     */
+    static uint64_t ToWallTime(uint64_t timestamp) {
+        return timestamp + s_wallOffset.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 墙上时间与时钟的差值，ToWallTime(t) == t + WallOffset()
+     */
+    static int64_t WallOffset() {return s_wallOffset.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 是否使用TSC
+     */
+    static bool IsTsc() {return s_tsc;}
+
+    /**
+     * @brief 按初始化以来的整个区间重新计算TSC频率，并更新墙上时间的差值。
+     *        距上次校准不足minInterval毫秒时不做处理
+     */
+    static void Recalibrate(uint32_t minInterval = 1000);
+
+private:
+    static uint64_t Scale(uint64_t ticks, uint64_t mult) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks) * mult) >> 32);
+    }
+
+    static uint64_t CoarseNow();
+
+    friend struct LogClockInit;
+
+    static bool s_tsc;
+    //换算参数，写入时s_seq为奇数
+    static std::atomic<uint32_t> s_seq;
+    static std::atomic<uint64_t> s_baseTsc;
+    static std::atomic<uint64_t> s_baseNs;
+    //每个tick的纳秒数，32.32定点数
+    static std::atomic<uint64_t> s_mult;
+    static std::atomic<int64_t> s_wallOffset;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGCLOCK_H
@@ -0,0 +1,337 @@
+/**
+ * @file logCompress.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-14.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logCompress.h"
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+KAFKA_NAMESPACE_BEGIN
+
+namespace {
+
+const uint32_t kFrameMagic = 0x184D2204;
+//FLG: 版本01，块独立
+const uint8_t kFrameFlag = 0x60;
+//BD: 最大块4MB
+const uint8_t kFrameBlock = 0x70;
+//块头最高位表示未压缩
+const uint32_t kUncompressedBit = 0x80000000u;
+
+const int kMinMatch = 4;
+//最后一个匹配必须在块结束前12字节之前开始
+const size_t kMatchLimit = 12;
+//最后5字节必须是字面量
+const size_t kLastLiterals = 5;
+const size_t kMaxOffset = 65535;
+const int kHashLog = 12;
+
+inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void writeLE32(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline uint32_t readLE32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+           | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline uint32_t rotl32(uint32_t v, int r) {
+    return (v << r) | (v >> (32 - r));
+}
+
+/**
+ * @brief xxHash32，用于帧头校验
+ */
+uint32_t xxh32(const uint8_t *p, size_t len, uint32_t seed) {
+    const uint32_t P1 = 2654435761u, P2 = 2246822519u, P3 = 3266489917u, P4 = 668265263u, P5 = 374761393u;
+    const uint8_t *end = p + len;
+    uint32_t h;
+    if (len >= 16) {
+        uint32_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        for (; p + 16 <= end; p += 16) {
+            v1 = rotl32(v1 + readLE32(p) * P2, 13) * P1;
+            v2 = rotl32(v2 + readLE32(p + 4) * P2, 13) * P1;
+            v3 = rotl32(v3 + readLE32(p + 8) * P2, 13) * P1;
+            v4 = rotl32(v4 + readLE32(p + 12) * P2, 13) * P1;
+        }
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    }
+    else {
+        h = seed + P5;
+    }
+    h += static_cast<uint32_t>(len);
+    for (; p + 4 <= end; p += 4) {
+        h = rotl32(h + readLE32(p) * P3, 17) * P4;
+    }
+    for (; p < end; ++p) {
+        h = rotl32(h + *p * P5, 11) * P1;
+    }
+    h ^= h >> 15;
+    h *= P2;
+    h ^= h >> 13;
+    h *= P3;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief 写入长度的扩展字节
+ */
+inline uint8_t* writeLength(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+/**
+ * @brief 写入一个序列: token 字面量长度 字面量 [偏移 匹配长度]
+ */
+inline uint8_t* writeSequence(uint8_t *op, const uint8_t *literals, size_t litLen, size_t offset, size_t matchLen) {
+    uint8_t *token = op++;
+    *token = static_cast<uint8_t>((litLen >= 15 ? 15 : litLen) << 4);
+    if (litLen >= 15) {
+        op = writeLength(op, litLen - 15);
+    }
+    memcpy(op, literals, litLen);
+    op += litLen;
+    if (!offset) {
+        return op;
+    }
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    matchLen -= kMinMatch;
+    *token |= static_cast<uint8_t>(matchLen >= 15 ? 15 : matchLen);
+    if (matchLen >= 15) {
+        op = writeLength(op, matchLen - 15);
+    }
+    return op;
+}
+
+bool writeAll(int fd, const void *data, size_t len) {
+    const char *p = static_cast<const char*>(data);
+    while (len) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+}
+
+size_t LogCompress::CompressBlock(const char *source, size_t n, char *dest) {
+    const uint8_t *src = reinterpret_cast<const uint8_t*>(source);
+    uint8_t *op = reinterpret_cast<uint8_t*>(dest);
+    size_t anchor = 0;
+    if (n > kMatchLimit) {
+        uint32_t table[1 << kHashLog];
+        memset(table, 0, sizeof(table));
+        size_t limit = n - kMatchLimit;
+        size_t matchEnd = n - kLastLiterals;
+        size_t ip = 0;
+        //连续未命中时逐渐加大步长，跳过不可压缩的数据
+        uint32_t misses = 0;
+        while (ip < limit) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - kHashLog);
+            size_t ref = table[h];
+            table[h] = static_cast<uint32_t>(ip);
+            if (ref >= ip || ip - ref > kMaxOffset || read32(src + ref) != seq) {
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            size_t len = kMinMatch;
+            while (ip + len < matchEnd && src[ref + len] == src[ip + len]) {
+                ++len;
+            }
+            op = writeSequence(op, src + anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+        }
+    }
+    op = writeSequence(op, src + anchor, n - anchor, 0, 0);
+    return static_cast<size_t>(reinterpret_cast<char*>(op) - dest);
+}
+
+bool LogCompress::DecompressBlock(const char *source, size_t n, std::string &out) {
+    const uint8_t *ip = reinterpret_cast<const uint8_t*>(source);
+    const uint8_t *end = ip + n;
+    size_t base = out.size();
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t litLen = token >> 4;
+        if (litLen == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return false;
+                }
+                b = *ip++;
+                litLen += b;
+            } while (b == 255);
+        }
+        if (static_cast<size_t>(end - ip) < litLen) {
+            return false;
+        }
+        out.append(reinterpret_cast<const char*>(ip), litLen);
+        ip += litLen;
+        if (ip == end) {
+            //最后一个序列只有字面量
+            return true;
+        }
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLen = token & 0x0f;
+        if (matchLen == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return false;
+                }
+                b = *ip++;
+                matchLen += b;
+            } while (b == 255);
+        }
+        matchLen += kMinMatch;
+        if (offset == 0 || offset > out.size() - base) {
+            return false;
+        }
+        //匹配可能与输出重叠，逐字节复制
+        size_t from = out.size() - offset;
+        for (size_t i = 0; i < matchLen; ++i) {
+            out.push_back(out[from + i]);
+        }
+    }
+    return true;
+}
+
+bool LogCompress::CompressFile(const std::string &src, const std::string &dst) {
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    std::string tmp = dst + ".tmp";
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    uint8_t header[7];
+    writeLE32(header, kFrameMagic);
+    header[4] = kFrameFlag;
+    header[5] = kFrameBlock;
+    header[6] = static_cast<uint8_t>(xxh32(header + 4, 2, 0) >> 8);
+    bool ok = writeAll(out, header, sizeof(header));
+
+    std::vector<char> block(kBlockSize);
+    std::vector<char> compressed(4 + CompressBound(kBlockSize));
+    while (ok) {
+        size_t len = 0;
+        while (len < kBlockSize) {
+            ssize_t n = ::read(in, &block[len], kBlockSize - len);
+            if (n < 0) {
+                ok = false;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            len += n;
+        }
+        if (!ok || len == 0) {
+            break;
+        }
+        size_t size = CompressBlock(&block[0], len, &compressed[4]);
+        if (size >= len) {
+            //不可压缩的块原样存储
+            writeLE32(reinterpret_cast<uint8_t*>(&compressed[0]), static_cast<uint32_t>(len) | kUncompressedBit);
+            ok = writeAll(out, &compressed[0], 4) && writeAll(out, &block[0], len);
+        }
+        else {
+            writeLE32(reinterpret_cast<uint8_t*>(&compressed[0]), static_cast<uint32_t>(size));
+            ok = writeAll(out, &compressed[0], 4 + size);
+        }
+    }
+    if (ok) {
+        uint8_t endMark[4] = {0, 0, 0, 0};
+        ok = writeAll(out, endMark, sizeof(endMark));
+    }
+    ::close(in);
+    ok = ::close(out) == 0 && ok;
+    if (!ok || ::rename(tmp.c_str(), dst.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool LogCompress::DecompressFrame(const char *data, size_t len, std::string &out) {
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t *end = p + len;
+    if (len < 7 || readLE32(p) != kFrameMagic) {
+        return false;
+    }
+    uint8_t flag = p[4];
+    //只支持本模块写出的格式: 无块校验、无内容长度、无字典
+    if ((flag & 0xc0) != 0x40 || (flag & 0x1b)) {
+        return false;
+    }
+    if (static_cast<uint8_t>(xxh32(p + 4, 2, 0) >> 8) != p[6]) {
+        return false;
+    }
+    bool contentChecksum = flag & 0x04;
+    p += 7;
+    while (true) {
+        if (end - p < 4) {
+            return false;
+        }
+        uint32_t size = readLE32(p);
+        p += 4;
+        if (size == 0) {
+            break;
+        }
+        bool raw = size & kUncompressedBit;
+        size &= ~kUncompressedBit;
+        if (static_cast<size_t>(end - p) < size) {
+            return false;
+        }
+        if (raw) {
+            out.append(reinterpret_cast<const char*>(p), size);
+        }
+        else if (!DecompressBlock(reinterpret_cast<const char*>(p), size, out)) {
+            return false;
+        }
+        p += size;
+    }
+    return !contentChecksum || end - p >= 4;
+}
+
+KAFKA_NAMESPACE_END
@@ -0,0 +1,72 @@
+/**
+ * @file logCompress.h
+ * @brief 日志文件压缩，LZ4块格式编码，输出标准LZ4帧格式
+ * @author ziv
+ * @email
+ * @date 22-11-14.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGCOMPRESS_H
+#define KAFKA_LOGCOMPRESS_H
+
+#include <stdint.h>
+#include <string>
+#include "../basic/basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 内置的LZ4压缩，不依赖外部库
+ * @details 块编码为LZ4块格式(贪心匹配)，文件为LZ4帧格式(独立块，4MB块大小，无校验和)，
+ *          压缩后的文件可以直接用 lz4 -d / lz4cat 解压
+ */
+class LogCompress {
+public:
+    //帧中每个块的最大原始长度
+    static const size_t kBlockSize = 4 * 1024 * 1024;
+
+    /**
+     * @brief 压缩n字节数据所需的最大输出空间
+     */
+    static size_t CompressBound(size_t n) {return n + n / 255 + 16;}
+
+    /**
+     * @brief 压缩一个块
+     * @param src 原始数据
+     * @param n 长度，不超过kBlockSize
+     * @param dst 输出，至少CompressBound(n)字节
+     * @return 输出长度
+     */
+    static size_t CompressBlock(const char *src, size_t n, char *dst);
+
+    /**
+     * @brief 解压一个块
+     * @param src 压缩数据
+     * @param n 长度
+     * @param out 追加到out
+     * @return 数据是否合法
+     */
+    static bool DecompressBlock(const char *src, size_t n, std::string &out);
+
+    /**
+     * @brief 压缩文件为LZ4帧
+     * @param src 原始文件
+     * @param dst 输出文件，先写入临时文件完成后再改名
+     * @return 是否成功
+     */
+    static bool CompressFile(const std::string &src, const std::string &dst);
+
+    /**
+     * @brief 解压LZ4帧
+     * @param data 帧数据
+     * @param len 长度
+     * @param out 追加到out
+     * @return 数据是否合法
+     */
+    static bool DecompressFrame(const char *data, size_t len, std::string &out);
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGCOMPRESS_H
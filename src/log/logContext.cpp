@@ -0,0 +1,70 @@
+/**
+ * @file logContext.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-21.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logContext.h"
+#include "../utils/utils.h"
+#include <pthread.h>
+#include <mutex>
+#include <unordered_set>
+
+KAFKA_NAMESPACE_BEGIN
+
+thread_local LogThreadContext LogThreadContext::t_context;
+
+namespace {
+
+/**
+ * @brief 线程名称表，不释放，保证事件中的指针一直有效
+ */
+struct NameTable {
+    std::mutex mutex;
+    std::unordered_set<std::string> names;
+};
+
+NameTable& nameTable() {
+    static NameTable *s_table = new NameTable;
+    return *s_table;
+}
+
+}
+
+const std::string& LogThreadContext::Intern(const std::string &name) {
+    NameTable &table = nameTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return *table.names.insert(name).first;
+}
+
+void LogThreadContext::setThreadName(const std::string &name) {
+    if (!m_threadName) {
+        init();
+    }
+    m_threadName = &Intern(name);
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+void LogThreadContext::init() {
+    static std::once_flag s_once;
+    std::call_once(s_once, [] {
+        //子进程中只有调用fork的线程，其线程id变化
+        pthread_atfork(nullptr, nullptr, [] {
+            t_context.m_threadName = nullptr;
+        });
+    });
+    m_threadId = static_cast<uint32_t>(KAFKA::getThreadId());
+    m_fiberId = KAFKA::getFiberId();
+    char name[16] = {0};
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) != 0 || !name[0]) {
+        m_threadName = &Intern(std::to_string(m_threadId));
+    }
+    else {
+        m_threadName = &Intern(name);
+    }
+}
+
+KAFKA_NAMESPACE_END
@@ -0,0 +1,91 @@
+/**
+ * @file logContext.h
+ * @brief 日志事件的线程上下文缓存
+ * @author ziv
+ * @email
+ * @date 22-11-21.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGCONTEXT_H
+#define KAFKA_LOGCONTEXT_H
+
+#include <stdint.h>
+#include <string>
+#include "logClock.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 当前线程的线程id、线程名称和协程id
+ * @details 线程id和名称在线程第一次写日志时通过系统调用获取一次，之后每条日志只读取缓存。
+ *          线程名称保存在进程内不释放的名称表中，事件只保存其指针，异步输出时线程退出也不失效。
+ *          fork后子进程的缓存重新获取
+ */
+class LogThreadContext : noncopyable {
+public:
+    /**
+     * @brief 当前线程的上下文
+     */
+    static LogThreadContext& Current() {return t_context;}
+
+    /**
+     * @brief 名称表中与name相同的字符串，引用一直有效
+     */
+    static const std::string& Intern(const std::string &name);
+
+    /**
+     * @brief 程序启动到现在的毫秒数，单调递增
+     */
+    static uint32_t Elapse() {return Elapse(LogClock::Now());}
+
+    /**
+     * @brief 时间戳对应的启动后毫秒数
+     * @param timestamp LogClock::Now()的时间戳
+     */
+    static uint32_t Elapse(uint64_t timestamp) {return static_cast<uint32_t>(timestamp / 1000000);}
+
+    uint32_t getThreadId() {
+        if (KAFKA_UNLIKELY(!m_threadName)) {
+            init();
+        }
+        return m_threadId;
+    }
+
+    /**
+     * @brief 线程名称，默认为系统中的线程名
+     */
+    const std::string& getThreadName() {
+        if (KAFKA_UNLIKELY(!m_threadName)) {
+            init();
+        }
+        return *m_threadName;
+    }
+
+    /**
+     * @brief 设置当前线程的名称，同时设置系统中的线程名(最多15个字符)
+     */
+    void setThreadName(const std::string &name);
+
+    uint32_t getFiberId() const {return m_fiberId;}
+
+    /**
+     * @brief 由协程调度在切换时设置
+     */
+    void setFiberId(uint32_t fiber_id) {m_fiberId = fiber_id;}
+
+private:
+    KAFKA_COLD void init();
+
+    uint32_t m_threadId = 0;
+    uint32_t m_fiberId = 0;
+    const std::string *m_threadName = nullptr;
+
+    static thread_local LogThreadContext t_context;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGCONTEXT_H
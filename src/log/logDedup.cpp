@@ -0,0 +1,80 @@
+/**
+ * @file logDedup.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-18.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logDedup.h"
+#include "logContext.h"
+#include <chrono>
+
+KAFKA_NAMESPACE_BEGIN
+
+LogDedupFilter::LogDedupFilter(uint32_t window) : m_window(window) {
+}
+
+bool LogDedupFilter::filter(const std::shared_ptr<Logger> &logger, const LogEvent::LogEventPtr &event,
+                            LogEvent::LogEventPtr &summary) {
+    uint64_t hash = Hash(*event);
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (hash == m_hash && m_file && now - m_start < m_window) {
+        ++m_repeats;
+        return true;
+    }
+    if (m_repeats) {
+        summary = makeSummary(logger);
+    }
+    m_hash = hash;
+    m_start = now;
+    m_level = event->getLevel();
+    m_file = event->getFile();
+    m_line = event->getLine();
+    m_site = event->getSite();
+    m_threadId = event->getThreadId();
+    m_fiberId = event->getFiberId();
+    m_threadName = &event->getThreadName();
+    return false;
+}
+
+LogEvent::LogEventPtr LogDedupFilter::expire(const std::shared_ptr<Logger> &logger, uint64_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_repeats || now - m_start < m_window) {
+        return nullptr;
+    }
+    //开始新的窗口，之后相同的记录继续折叠
+    m_start = now;
+    return makeSummary(logger);
+}
+
+LogEvent::LogEventPtr LogDedupFilter::makeSummary(const std::shared_ptr<Logger> &logger) {
+    uint64_t now = LogClock::Now();
+    LogEvent::LogEventPtr event = LogEventPool::Acquire(logger, m_level, m_file, m_line, LogThreadContext::Elapse(now),
+                                                        m_threadId, m_fiberId, now, *m_threadName);
+    event->setSite(m_site);
+    event->getSS() << "last message repeated " << m_repeats << " times";
+    m_repeats = 0;
+    return event;
+}
+
+uint64_t LogDedupFilter::Hash(const LogEvent &event) {
+    //FNV-1a，先混入调用点
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t key = event.getSite() ? reinterpret_cast<uintptr_t>(event.getSite())
+                                   : reinterpret_cast<uintptr_t>(event.getFile()) ^ static_cast<uint64_t>(event.getLine());
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        hash = (hash ^ ((key >> (i * 8)) & 0xff)) * 1099511628211ULL;
+    }
+    StringView content = event.getContent();
+    for (size_t i = 0; i < content.size(); ++i) {
+        hash = (hash ^ static_cast<uint8_t>(content.data()[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+KAFKA_NAMESPACE_END
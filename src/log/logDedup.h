@@ -0,0 +1,86 @@
+/**
+ * @file logDedup.h
+ * @brief 重复日志折叠
+ * @author ziv
+ * @email
+ * @date 22-11-18.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGDEDUP_H
+#define KAFKA_LOGDEDUP_H
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include "log.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 重复日志折叠，挂在Logger上，在分发和格式化之前过滤
+ * @details 按(调用点, 日志内容)计算hash，与上一条记录相同且在窗口内时丢弃，只计数。
+ *          窗口结束后(下一条不同或窗口外的记录到来，或定时检查时)补一条
+ *          "last message repeated N times"，级别和位置与被折叠的记录相同
+ */
+class LogDedupFilter : noncopyable {
+public:
+    typedef std::shared_ptr<LogDedupFilter> LogDedupFilterPtr;
+
+    /**
+     * @brief
+     * @param window 窗口长度(毫秒)
+     */
+    explicit LogDedupFilter(uint32_t window);
+
+    uint32_t getWindow() const {return m_window;}
+
+    /**
+     * @brief 过滤一条记录
+     * @param logger 所属日志器
+     * @param event
+     * @param summary 之前折叠的记录需要补汇总时返回汇总事件，需先于event输出
+     * @return 是否重复，重复时丢弃event
+     */
+    bool filter(const std::shared_ptr<Logger> &logger, const LogEvent::LogEventPtr &event,
+                LogEvent::LogEventPtr &summary);
+
+    /**
+     * @brief 定时检查，窗口已结束且有折叠的记录时返回汇总事件
+     * @param logger 所属日志器
+     * @param now 当前时间(steady_clock毫秒)
+     */
+    LogEvent::LogEventPtr expire(const std::shared_ptr<Logger> &logger, uint64_t now);
+
+private:
+    /**
+     * @brief 生成汇总事件并清零计数，需持有m_mutex
+     */
+    LogEvent::LogEventPtr makeSummary(const std::shared_ptr<Logger> &logger);
+
+    static uint64_t Hash(const LogEvent &event);
+
+private:
+    uint32_t m_window;
+    std::mutex m_mutex;
+    //上一条输出的记录，不持有事件本身，避免事件引用日志器形成循环
+    uint64_t m_hash = 0;
+    LogLevel::Level m_level = LogLevel::UNKNOWN;
+    const char *m_file = nullptr;
+    int32_t m_line = 0;
+    const LogSite *m_site = nullptr;
+    uint32_t m_threadId = 0;
+    uint32_t m_fiberId = 0;
+    const std::string *m_threadName = nullptr;
+    //窗口开始时间
+    uint64_t m_start = 0;
+    //窗口内折叠的次数
+    uint64_t m_repeats = 0;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGDEDUP_H
@@ -0,0 +1,131 @@
+/**
+ * @file logDispatcher.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-4.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logDispatcher.h"
+#include <sched.h>
+#include <chrono>
+#include <algorithm>
+
+KAFKA_NAMESPACE_BEGIN
+
+//消费线程空闲时的最长休眠时间(微秒)
+static const int kMaxIdleSleepUs = 1000;
+
+AsyncLogDispatcher::AsyncLogDispatcher(size_t capacity)
+    : m_ring(capacity), m_running(false), m_stopped(true), m_fullWaits(0) {
+    start();
+}
+
+AsyncLogDispatcher::~AsyncLogDispatcher() {
+    stop();
+}
+
+void AsyncLogDispatcher::dispatch(Logger *logger, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+    Item item;
+    item.logger = logger;
+    item.level = level;
+    item.event = event;
+    if (KAFKA_UNLIKELY(event->getLogger().get() != logger)) {
+        item.owner = logger->shared_from_this();
+    }
+    if (KAFKA_LIKELY(m_running.load(std::memory_order_acquire))) {
+        while (!m_ring.tryPush(std::move(item))) {
+            m_fullWaits.fetch_add(1, std::memory_order_relaxed);
+            //消费线程已退出时由生产者自己腾出位置
+            if (m_stopped.load(std::memory_order_acquire)) {
+                drainStopped();
+            }
+            sched_yield();
+        }
+        //与消费线程退出前的检查配对: 这里读到m_running为true时，消费线程最后一次drain一定能取到刚写入的事件；
+        //否则事件可能滞留在队列中，由当前线程取出输出
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (KAFKA_UNLIKELY(!m_running.load(std::memory_order_relaxed))) {
+            waitStopped();
+            drainStopped();
+        }
+        return;
+    }
+    //先输出队列中剩余的事件，再在当前线程输出，保持同一线程的顺序
+    waitStopped();
+    drainStopped();
+    item.logger->doLog(item.level, item.event);
+}
+
+void AsyncLogDispatcher::waitStopped() {
+    while (!m_stopped.load(std::memory_order_acquire) && !m_running.load(std::memory_order_acquire)) {
+        sched_yield();
+    }
+}
+
+void AsyncLogDispatcher::drainStopped() {
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    //重新启动后由新的消费线程输出
+    if (m_stopped.load(std::memory_order_acquire)) {
+        drain();
+    }
+}
+
+void AsyncLogDispatcher::start() {
+    if (m_running) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    //等待正在输出剩余事件的生产者，之后只有新的消费线程读取队列
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    m_stopped = false;
+    m_running = true;
+    m_thread = std::thread(&AsyncLogDispatcher::threadFunc, this);
+}
+
+void AsyncLogDispatcher::stop() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+size_t AsyncLogDispatcher::drain() {
+    size_t count = 0;
+    Item item;
+    while (m_ring.tryPop(item)) {
+        item.logger->doLog(item.level, item.event);
+        item.event.reset();
+        item.owner.reset();
+        ++count;
+    }
+    return count;
+}
+
+void AsyncLogDispatcher::threadFunc() {
+    int idleUs = 0;
+    while (m_running.load(std::memory_order_acquire)) {
+        if (drain() > 0) {
+            idleUs = 0;
+            continue;
+        }
+        //空闲时逐步退避，避免消费线程空转
+        if (idleUs == 0) {
+            sched_yield();
+            idleUs = 1;
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(idleUs));
+            idleUs = std::min(idleUs * 2, kMaxIdleSleepUs);
+        }
+    }
+    //与dispatch写入后的检查配对，之后才写入的事件由生产者自己输出
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drain();
+    m_stopped.store(true, std::memory_order_release);
+}
+
+KAFKA_NAMESPACE_END
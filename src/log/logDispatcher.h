@@ -0,0 +1,107 @@
+/**
+ * @file logDispatcher.h
+ * @brief 日志事件异步分发
+ * @author ziv
+ * @email
+ * @date 22-11-4.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGDISPATCHER_H
+#define KAFKA_LOGDISPATCHER_H
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include "log.h"
+#include "mpscRing.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 日志事件分发器
+ * @details Logger::log 只把事件写入无锁环形队列，由分发器自己的消费线程调用appender输出。
+ *          多个Logger可以共用一个分发器，每个分发器对应一个消费线程
+ */
+class AsyncLogDispatcher : noncopyable {
+public:
+    typedef std::shared_ptr<AsyncLogDispatcher> AsyncLogDispatcherPtr;
+
+    /**
+     * @brief
+     * @param capacity 队列容量
+     */
+    explicit AsyncLogDispatcher(size_t capacity = 65536);
+
+    ~AsyncLogDispatcher();
+
+    /**
+     * @brief 生产者投递事件，队列满时让出CPU重试，不加锁
+     * @details 未启动或已停止时在调用线程直接输出。事件持有创建它的日志器，
+     *          logger就是该日志器时队列中只保存裸指针，不修改日志器的引用计数
+     * @param logger 日志器
+     * @param level 日志级别
+     * @param event 日志事件
+     */
+    void dispatch(Logger *logger, LogLevel::Level level, const LogEvent::LogEventPtr &event);
+
+    /**
+     * @brief 启动消费线程
+     */
+    void start();
+
+    /**
+     * @brief 停止消费线程，队列中剩余的事件全部输出
+     */
+    void stop();
+
+    /**
+     * @brief 生产者因队列满而等待的次数
+     */
+    uint64_t getFullWaits() const {return m_fullWaits.load(std::memory_order_relaxed);}
+
+private:
+    struct Item {
+        Logger *logger = nullptr;
+        LogLevel::Level level = LogLevel::UNKNOWN;
+        LogEvent::LogEventPtr event;
+        //logger不是事件的创建者时持有它，如根日志器输出子日志器的事件
+        Logger::LoggerPtr owner;
+    };
+
+    void threadFunc();
+
+    /**
+     * @brief 输出队列中所有事件，只能由消费线程或持有m_drainMutex且消费线程已退出时调用
+     * @return 输出的事件数量
+     */
+    size_t drain();
+
+    /**
+     * @brief 停止后等待消费线程退出
+     */
+    void waitStopped();
+
+    /**
+     * @brief 消费线程已退出时在调用线程输出队列中剩余的事件
+     */
+    void drainStopped();
+
+private:
+    MpscRing<Item> m_ring;
+    std::thread m_thread;
+    //是否接收新的事件
+    std::atomic<bool> m_running;
+    //消费线程已退出，队列中没有剩余的事件
+    std::atomic<bool> m_stopped;
+    //消费线程退出后，生产者输出队列中剩余的事件时加锁，不在正常写入的路径上
+    std::mutex m_drainMutex;
+    std::atomic<uint64_t> m_fullWaits;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGDISPATCHER_H
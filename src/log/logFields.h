@@ -0,0 +1,187 @@
+/**
+ * @file logFields.h
+ * @brief 结构化日志的键值字段
+ * @author ziv
+ * @email
+ * @date 22-11-19.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGFIELDS_H
+#define KAFKA_LOGFIELDS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include "logBuffer.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+#include "../basic/stringView.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 一个键值字段，只引用键和字符串值，用于写入 LogFields
+ * @details 用法: KAFKA_LOG_INFO(logger) << "login" << KAFKA::LogField("user", uid) << KAFKA::LogField("ok", true);
+ */
+class LogField {
+friend class LogFields;
+public:
+    enum Type : uint8_t {
+        INT = 0,
+        UINT,
+        DOUBLE,
+        BOOL,
+        STRING};
+
+    union Value {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+    };
+
+    template<class T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    LogField(const StringView &key, T v) : m_key(key), m_type(INT) {m_value.i = v;}
+
+    template<class T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value
+                                              && !std::is_same<T, bool>::value, int>::type = 0>
+    LogField(const StringView &key, T v) : m_key(key), m_type(UINT) {m_value.u = v;}
+
+    template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    LogField(const StringView &key, T v) : m_key(key), m_type(DOUBLE) {m_value.d = static_cast<double>(v);}
+
+    LogField(const StringView &key, bool v) : m_key(key), m_type(BOOL) {m_value.b = v;}
+
+    LogField(const StringView &key, const char *v) : m_key(key), m_type(STRING), m_str(v ? v : "(null)") {m_value.u = 0;}
+
+    LogField(const StringView &key, const std::string &v) : m_key(key), m_type(STRING), m_str(v) {m_value.u = 0;}
+
+    LogField(const StringView &key, const StringView &v) : m_key(key), m_type(STRING), m_str(v) {m_value.u = 0;}
+
+    const StringView& getKey() const {return m_key;}
+
+    Type getType() const {return m_type;}
+
+    const Value& getValue() const {return m_value;}
+
+    const StringView& getString() const {return m_str;}
+
+    /**
+     * @brief 按文本格式写入值，字符串原样写入
+     */
+    template<size_t N>
+    void appendValue(InlineBuffer<N> &buf) const {
+        switch (m_type) {
+            case INT:
+                buf.appendInt(m_value.i);
+                break;
+            case UINT:
+                buf.appendUInt(m_value.u);
+                break;
+            case DOUBLE: {
+                char *p = buf.reserve(32);
+                buf.commit(snprintf(p, 32, "%g", m_value.d));
+                break;
+            }
+            case BOOL:
+                buf.append(m_value.b ? "true" : "false");
+                break;
+            case STRING:
+                buf.append(m_str.data(), m_str.size());
+                break;
+        }
+    }
+
+private:
+    StringView m_key;
+    Type m_type;
+    Value m_value;
+    StringView m_str;
+};
+
+/**
+ * @brief 日志事件的键值字段
+ * @details 字段描述存放在定长数组中，键和字符串值拷贝到内部缓冲区，小于其内部存储时不分配内存；
+ *          随事件对象一起复用。超过kMaxFields的字段被丢弃
+ */
+class LogFields : noncopyable {
+public:
+    static const size_t kMaxFields = 16;
+
+    /**
+     * @brief 添加字段，拷贝键和字符串值
+     */
+    void add(const LogField &field) {
+        if (m_size == kMaxFields) {
+            return;
+        }
+        Entry &entry = m_entries[m_size++];
+        entry.type = field.getType();
+        entry.value = field.getValue();
+        entry.key = static_cast<uint32_t>(m_data.size());
+        entry.keyLen = static_cast<uint32_t>(field.getKey().size());
+        m_data.append(field.getKey().data(), field.getKey().size());
+        entry.str = static_cast<uint32_t>(m_data.size());
+        entry.strLen = static_cast<uint32_t>(field.getString().size());
+        m_data.append(field.getString().data(), field.getString().size());
+    }
+
+    size_t size() const {return m_size;}
+
+    bool empty() const {return m_size == 0;}
+
+    /**
+     * @brief 第i个字段，引用内部缓冲区，再次add后失效
+     */
+    LogField get(size_t i) const {
+        const Entry &entry = m_entries[i];
+        StringView key(m_data.data() + entry.key, entry.keyLen);
+        LogField field(key, StringView(m_data.data() + entry.str, entry.strLen));
+        field.m_type = entry.type;
+        field.m_value = entry.value;
+        return field;
+    }
+
+    /**
+     * @brief 清空字段，保留已分配的空间
+     */
+    void clear() {
+        m_size = 0;
+        m_data.clear();
+    }
+
+    /**
+     * @brief 按 " key=value" 的文本格式写入全部字段
+     */
+    template<size_t N>
+    void appendText(InlineBuffer<N> &buf) const {
+        for (size_t i = 0; i < m_size; ++i) {
+            LogField field = get(i);
+            buf.append(' ');
+            buf.append(field.getKey().data(), field.getKey().size());
+            buf.append('=');
+            field.appendValue(buf);
+        }
+    }
+
+private:
+    struct Entry {
+        LogField::Type type;
+        LogField::Value value;
+        uint32_t key;
+        uint32_t keyLen;
+        uint32_t str;
+        uint32_t strLen;
+    };
+
+    Entry m_entries[kMaxFields];
+    size_t m_size = 0;
+    //键和字符串值
+    InlineBuffer<256> m_data;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGFIELDS_H
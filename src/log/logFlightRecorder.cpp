@@ -0,0 +1,312 @@
+/**
+ * @file logFlightRecorder.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-20.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logFlightRecorder.h"
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <execinfo.h>
+#include <limits.h>
+#include <algorithm>
+
+KAFKA_NAMESPACE_BEGIN
+
+std::atomic<bool> LogFlightRecorder::s_enabled{false};
+
+namespace {
+
+/**
+ * @brief 一条记录，seq为写完时的pos+1，写入过程中为0，读取前后seq相同时内容完整
+ */
+struct Slot {
+    std::atomic<uint64_t> seq{0};
+    const LogSite *site;
+    uint32_t len;
+    char data[LogFlightRecorder::kSlotSize];
+};
+
+/**
+ * @brief 一个线程的环，只由所属线程写入
+ */
+struct Ring {
+    Slot slots[LogFlightRecorder::kSlots];
+    //已写入的记录总数
+    std::atomic<uint64_t> pos{0};
+    std::atomic<bool> inUse{true};
+    Ring *next = nullptr;
+};
+
+//全部的环，只增加不删除，信号处理中无锁遍历
+std::atomic<Ring*> s_rings{nullptr};
+char s_filename[PATH_MAX];
+
+/**
+ * @brief 线程退出时归还环
+ */
+struct RingHolder {
+    Ring *ring = nullptr;
+    ~RingHolder() {
+        if (ring) {
+            ring->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local Ring *t_ring = nullptr;
+thread_local RingHolder t_holder;
+
+KAFKA_COLD Ring* acquireRing() {
+    Ring *ring = nullptr;
+    for (Ring *it = s_rings.load(std::memory_order_acquire); it; it = it->next) {
+        bool expected = false;
+        if (!it->inUse.load(std::memory_order_relaxed)
+            && it->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            ring = it;
+            break;
+        }
+    }
+    if (!ring) {
+        ring = new Ring;
+        ring->next = s_rings.load(std::memory_order_relaxed);
+        while (!s_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+    t_holder.ring = ring;
+    t_ring = ring;
+    return ring;
+}
+
+/**
+ * @brief 写文件时合并小块写入，不分配内存
+ */
+class FdWriter {
+public:
+    explicit FdWriter(int fd) : m_fd(fd) {}
+
+    void append(const void *data, size_t len) {
+        if (m_size + len > sizeof(m_buffer)) {
+            flush();
+            if (len > sizeof(m_buffer)) {
+                writeAll(data, len);
+                return;
+            }
+        }
+        memcpy(m_buffer + m_size, data, len);
+        m_size += len;
+    }
+
+    template<class T>
+    void appendValue(T value) {
+        append(&value, sizeof(value));
+    }
+
+    void appendString(const char *str) {
+        uint32_t len = static_cast<uint32_t>(strlen(str));
+        appendValue(len);
+        append(str, len);
+    }
+
+    void flush() {
+        writeAll(m_buffer, m_size);
+        m_size = 0;
+    }
+
+    bool good() const {return m_good;}
+
+private:
+    void writeAll(const void *data, size_t len) {
+        const char *p = static_cast<const char*>(data);
+        while (len) {
+            ssize_t n = ::write(m_fd, p, len);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                m_good = false;
+                return;
+            }
+            p += n;
+            len -= n;
+        }
+    }
+
+    int m_fd;
+    bool m_good = true;
+    size_t m_size = 0;
+    char m_buffer[4096];
+};
+
+//已写入描述的调用点，id超出范围的每次都写
+const size_t kSiteBits = 65536;
+uint64_t s_sitesWritten[2][kSiteBits / 64];
+
+void writeSite(FdWriter &writer, const LogSite *site, uint32_t id) {
+    bool text = id & LogFlightRecorder::kTextSite;
+    uint32_t index = id & ~LogFlightRecorder::kTextSite;
+    if (index < kSiteBits) {
+        uint64_t &bits = s_sitesWritten[text][index / 64];
+        if (bits & (1ULL << (index % 64))) {
+            return;
+        }
+        bits |= 1ULL << (index % 64);
+    }
+    const char *format = text ? "%s" : site->getFormat();
+    const char *types = text ? "s" : (site->getArgTypes() ? site->getArgTypes() : "");
+    uint32_t len = sizeof(uint32_t) + sizeof(int32_t) + 3 * sizeof(uint32_t)
+                   + strlen(site->getFile()) + strlen(format) + strlen(types);
+    writer.appendValue<uint8_t>(BinaryLog::kSiteFrame);
+    writer.appendValue<uint32_t>(len);
+    writer.appendValue<uint32_t>(id);
+    writer.appendValue<int32_t>(site->getLine());
+    writer.appendString(site->getFile());
+    writer.appendString(format);
+    writer.appendString(types);
+}
+
+void writeBacktrace(FdWriter &writer, int fd, int sig) {
+    writer.appendValue<uint8_t>(LogFlightRecorder::kBacktraceFrame);
+    writer.appendValue<uint32_t>(0);
+    writer.appendValue<uint32_t>(static_cast<uint32_t>(sig));
+    writer.flush();
+    off_t begin = lseek(fd, 0, SEEK_CUR);
+    void *frames[64];
+    int n = backtrace(frames, sizeof(frames) / sizeof(frames[0]));
+    backtrace_symbols_fd(frames, n, fd);
+    off_t end = lseek(fd, 0, SEEK_CUR);
+    if (begin < 0 || end < begin) {
+        return;
+    }
+    //回填帧长度
+    uint32_t len = static_cast<uint32_t>(end - begin + sizeof(uint32_t));
+    pwrite(fd, &len, sizeof(len), begin - 2 * sizeof(uint32_t));
+}
+
+}
+
+void LogFlightRecorder::Enable(const std::string &filename) {
+    size_t len = std::min(filename.size(), sizeof(s_filename) - 1);
+    memcpy(s_filename, filename.data(), len);
+    s_filename[len] = '\0';
+    //第一次调用backtrace会加载libgcc，提前调用避免在信号处理中分配内存
+    void *frames[1];
+    backtrace(frames, 1);
+    s_enabled.store(true, std::memory_order_release);
+    LoggerMgr::GetInstance()->installFlushSignalHandler();
+}
+
+void LogFlightRecorder::Disable() {
+    s_enabled.store(false, std::memory_order_release);
+}
+
+char* LogFlightRecorder::BeginSlot(const LogSite &site) {
+    Ring *ring = t_ring;
+    if (KAFKA_UNLIKELY(!ring)) {
+        ring = acquireRing();
+    }
+    Slot &slot = ring->slots[ring->pos.load(std::memory_order_relaxed) % kSlots];
+    //先标记为写入中，之后的写入不会排到标记之前
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.site = &site;
+    return slot.data;
+}
+
+void LogFlightRecorder::CommitSlot(size_t len) {
+    Ring *ring = t_ring;
+    uint64_t pos = ring->pos.load(std::memory_order_relaxed);
+    Slot &slot = ring->slots[pos % kSlots];
+    //截断时解码得到的参数不完整
+    uint32_t frameLen = static_cast<uint32_t>(len - sizeof(uint8_t) - sizeof(uint32_t));
+    memcpy(slot.data + sizeof(uint8_t), &frameLen, sizeof(frameLen));
+    slot.len = static_cast<uint32_t>(len);
+    slot.seq.store(pos + 1, std::memory_order_release);
+    ring->pos.store(pos + 1, std::memory_order_release);
+}
+
+void LogFlightRecorder::RecordFrame(const LogSite &site, const char *frame, size_t len) {
+    SlotBuffer buf(BeginSlot(site));
+    buf.append(frame, len);
+    CommitSlot(buf.size());
+}
+
+void LogFlightRecorder::RecordEvent(const LogEvent &event) {
+    const LogSite *site = event.getSite();
+    if (!site) {
+        return;
+    }
+    SlotBuffer buf(BeginSlot(*site));
+    buf.appendValue<uint8_t>(BinaryLog::kRecordFrame);
+    buf.appendValue<uint32_t>(0);
+    buf.appendValue<uint32_t>(site->getId() | kTextSite);
+    buf.appendValue<uint8_t>(static_cast<uint8_t>(event.getLevel()));
+    buf.appendValue<uint64_t>(event.getTimestamp());
+    buf.appendValue<uint32_t>(event.getElapse());
+    buf.appendValue<uint32_t>(event.getThreadId());
+    buf.appendValue<uint32_t>(event.getFiberId());
+    BinaryStringArg::encode(buf, event.getThreadName().data(), event.getThreadName().size());
+    //正文只保留能放进一条记录的部分，保证解码完整
+    StringView content = event.getContent();
+    size_t room = kSlotSize > buf.size() + sizeof(uint32_t) ? kSlotSize - buf.size() - sizeof(uint32_t) : 0;
+    BinaryStringArg::encode(buf, content.data(), std::min(content.size(), room));
+    CommitSlot(buf.size());
+}
+
+bool LogFlightRecorder::Dump(const char *filename, int sig) {
+    if (!filename) {
+        filename = s_filename;
+    }
+    if (!*filename) {
+        return false;
+    }
+    int fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    memset(s_sitesWritten, 0, sizeof(s_sitesWritten));
+
+    FdWriter writer(fd);
+    writer.append(BinaryLog::Magic(), strlen(BinaryLog::Magic()));
+    writer.appendValue<uint32_t>(BinaryLog::kVersion);
+    writer.appendValue<int64_t>(LogClock::WallOffset());
+    writer.appendString("flight-recorder");
+    for (Ring *ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        uint64_t end = ring->pos.load(std::memory_order_acquire);
+        uint64_t begin = end > kSlots ? end - kSlots : 0;
+        for (uint64_t pos = begin; pos < end; ++pos) {
+            const Slot &slot = ring->slots[pos % kSlots];
+            //其他线程可能正在覆盖，先复制，复制前后seq都等于pos+1时才使用
+            if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+                continue;
+            }
+            const LogSite *site = slot.site;
+            uint32_t len = std::min<uint32_t>(slot.len, kSlotSize);
+            char data[kSlotSize];
+            memcpy(data, slot.data, len);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != pos + 1) {
+                continue;
+            }
+            uint32_t id;
+            if (len < sizeof(uint8_t) + 2 * sizeof(uint32_t) || data[0] != static_cast<char>(BinaryLog::kRecordFrame)
+                || !site) {
+                continue;
+            }
+            memcpy(&id, data + sizeof(uint8_t) + sizeof(uint32_t), sizeof(id));
+            writeSite(writer, site, id);
+            writer.append(data, len);
+        }
+    }
+    writeBacktrace(writer, fd, sig);
+    bool good = writer.good();
+    ::close(fd);
+    return good;
+}
+
+KAFKA_NAMESPACE_END
@@ -0,0 +1,170 @@
+/**
+ * @file logFlightRecorder.h
+ * @brief 崩溃时写出的最近日志记录
+ * @author ziv
+ * @email
+ * @date 22-11-20.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGFLIGHTRECORDER_H
+#define KAFKA_LOGFLIGHTRECORDER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#include "log.h"
+#include "binaryLog.h"
+#include "logBuffer.h"
+#include "logContext.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 每个线程一个定长环形缓冲区，保存最近kSlots条日志的二进制记录帧
+ * @details 开启后级别被过滤的日志也写入环。格式化方式的宏(KAFKA_LOG_FMT_*)只编码原始参数，不做格式化；
+ *          流方式的宏记录格式化后的日志正文，被过滤的日志只写入环，不交给日志器。
+ *          收到致命信号时(见 LoggerManager::installFlushSignalHandler)把全部线程的环和调用栈写到文件，
+ *          文件格式同 BinaryLogWriter，可以直接用kafka-logdecode解码，调用栈为'B'帧。
+ *          线程退出后其环保留到被新线程复用
+ */
+class LogFlightRecorder : noncopyable {
+public:
+    //每个线程保存的记录数
+    static const size_t kSlots = 256;
+    //每条记录的最大长度，超出的部分截断
+    static const size_t kSlotSize = 240;
+    //调用栈帧
+    static const uint8_t kBacktraceFrame = 'B';
+    //正文记录使用的调用点id标记，对应格式"%s"
+    static const uint32_t kTextSite = 0x80000000u;
+
+    /**
+     * @brief 开启记录，并安装致命信号处理
+     * @details 开启期间流方式的宏(KAFKA_LOG_INFO等)对级别被过滤的日志也从对象池取出事件并执行<<的格式化，
+     *          开销与一条输出的日志的构造部分相当，远高于格式化方式的宏只编码参数的开销；
+     *          对被过滤日志开销敏感的调用点应使用KAFKA_LOG_FMT_*
+     * @param filename 崩溃时写出的文件
+     */
+    static void Enable(const std::string &filename);
+
+    static void Disable();
+
+    static bool IsEnabled() {return s_enabled.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 记录一条格式化方式的日志，只编码调用点id和原始参数，直接写入当前线程环中的下一条记录
+     * @details 开启记录后DEBUG等被过滤的级别也走这里，不用cold以免按代码大小优化
+     */
+    template<class... Args>
+    KAFKA_NOINLINE static void Record(LogLevel::Level level, LogSite &site, const Args&... args) {
+        static const char s_types[] = {BinaryArg<Args>::kType..., '\0'};
+        if (KAFKA_UNLIKELY(!site.getArgTypes())) {
+            site.setArgTypes(s_types);
+        }
+        LogThreadContext &context = LogThreadContext::Current();
+        const std::string &thread_name = context.getThreadName();
+        uint64_t now = LogClock::Now();
+        SlotBuffer buf(BeginSlot(site));
+        buf.appendValue<uint8_t>(BinaryLog::kRecordFrame);
+        buf.appendValue<uint32_t>(0);
+        buf.appendValue<uint32_t>(site.getId());
+        buf.appendValue<uint8_t>(static_cast<uint8_t>(level));
+        buf.appendValue<uint64_t>(now);
+        buf.appendValue<uint32_t>(LogThreadContext::Elapse(now));
+        buf.appendValue<uint32_t>(context.getThreadId());
+        buf.appendValue<uint32_t>(context.getFiberId());
+        BinaryStringArg::encode(buf, thread_name.data(), thread_name.size());
+        int dummy[] = {0, (BinaryArg<Args>::encode(buf, args), 0)...};
+        (void)dummy;
+        CommitSlot(buf.size());
+    }
+
+    /**
+     * @brief 记录一个编码好的记录帧
+     */
+    static void RecordFrame(const LogSite &site, const char *frame, size_t len);
+
+    /**
+     * @brief 记录一条事件的正文
+     */
+    static void RecordEvent(const LogEvent &event);
+
+    /**
+     * @brief 把全部线程的记录和当前调用栈写到文件，只使用异步信号安全的调用
+     * @param filename 文件名，为空时使用Enable设置的文件
+     * @param sig 触发的信号，写入调用栈帧
+     * @return 是否成功
+     */
+    static bool Dump(const char *filename = nullptr, int sig = 0);
+
+private:
+    /**
+     * @brief 一条记录的写入缓冲区，超出kSlotSize的部分截断
+     */
+    class SlotBuffer {
+    public:
+        explicit SlotBuffer(char *data) : m_data(data) {}
+
+        void append(const char *data, size_t len) {
+            if (KAFKA_UNLIKELY(len > kSlotSize - m_size)) {
+                len = kSlotSize - m_size;
+            }
+            Copy(m_data + m_size, data, len);
+            m_size += len;
+        }
+
+        template<class T>
+        void appendValue(T value) {
+            append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        size_t size() const {return m_size;}
+
+    private:
+        /**
+         * @brief 按定长块拷贝，避免编译器对变长的短拷贝生成启动开销较大的rep movs
+         */
+        static void Copy(char *dst, const char *src, size_t len) {
+            for (; len >= 16; len -= 16, dst += 16, src += 16) {
+                memcpy(dst, src, 16);
+            }
+            if (len >= 8) {
+                memcpy(dst, src, 8);
+                memcpy(dst + len - 8, src + len - 8, 8);
+            }
+            else if (len >= 4) {
+                memcpy(dst, src, 4);
+                memcpy(dst + len - 4, src + len - 4, 4);
+            }
+            else {
+                for (; len; --len) {
+                    *dst++ = *src++;
+                }
+            }
+        }
+
+        char *m_data;
+        size_t m_size = 0;
+    };
+
+    /**
+     * @brief 当前线程环中的下一条记录，长度为kSlotSize
+     */
+    static char* BeginSlot(const LogSite &site);
+
+    /**
+     * @brief 回填帧长度并提交当前线程的下一条记录
+     * @param len 记录帧的长度
+     */
+    static void CommitSlot(size_t len);
+
+    static std::atomic<bool> s_enabled;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGFLIGHTRECORDER_H
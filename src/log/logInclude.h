@@ -11,5 +11,12 @@
 #define KAFKA_LOGINCLUDE_H
 
 #include "log.h"
+#include "logSite.h"
+#include "logDedup.h"
+#include "staticLogFormatter.h"
+#include "jsonLogFormatter.h"
+#include "rollingFileLogAppender.h"
+#include "mmapFileLogAppender.h"
+#include "uringFileLogAppender.h"
 
 #endif //KAFKA_LOGINCLUDE_H
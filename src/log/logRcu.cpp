@@ -0,0 +1,176 @@
+/**
+ * @file logRcu.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-24.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logRcu.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+KAFKA_NAMESPACE_BEGIN
+
+namespace {
+
+//读者槽位数，超过后的线程使用共享计数
+const size_t kRcuSlots = 256;
+
+/**
+ * @brief 线程的读者槽位，epoch为0表示不在临界区内
+ */
+struct alignas(64) RcuSlot {
+    std::atomic<uint64_t> epoch;
+    std::atomic<bool> used;
+};
+
+RcuSlot s_slots[kRcuSlots];
+//每次Retire加1，从1开始
+std::atomic<uint64_t> s_epoch(1);
+//没有槽位的线程中正在临界区内的读者数
+std::atomic<uint32_t> s_overflowReaders(0);
+
+struct Retired {
+    uint64_t epoch;
+    std::function<void()> deleter;
+};
+
+/**
+ * @brief 等待释放的对象，不释放，保证线程退出时仍可使用
+ */
+struct RetiredList {
+    std::mutex mutex;
+    std::vector<Retired> items;
+};
+
+RetiredList& retiredList() {
+    static RetiredList *s_list = new RetiredList;
+    return *s_list;
+}
+
+//当前线程的槽位，没有槽位时为空
+thread_local RcuSlot *t_slot = nullptr;
+//槽位已用完或线程正在退出时不再申请
+thread_local bool t_noSlot = false;
+//临界区嵌套深度
+thread_local uint32_t t_depth = 0;
+
+/**
+ * @brief 线程退出时归还槽位
+ */
+struct SlotOwner {
+    ~SlotOwner() {
+        if (t_slot) {
+            t_slot->used.store(false, std::memory_order_release);
+            t_slot = nullptr;
+        }
+        t_noSlot = true;
+    }
+};
+
+RcuSlot* claimSlot() {
+    for (auto &slot : s_slots) {
+        bool expected = false;
+        if (!slot.used.load(std::memory_order_relaxed)
+            && slot.used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            static thread_local SlotOwner t_owner;
+            (void)t_owner;
+            t_slot = &slot;
+            return &slot;
+        }
+    }
+    t_noSlot = true;
+    return nullptr;
+}
+
+/**
+ * @brief 取出已经没有读者的对象，需持有RetiredList::mutex
+ */
+void collect(RetiredList &list, std::vector<Retired> &out) {
+    //与读者进入临界区时的屏障配对：读者读到了旧指针时，这里一定能看到它的槽位
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (list.items.empty() || s_overflowReaders.load(std::memory_order_relaxed)) {
+        return;
+    }
+    uint64_t min = UINT64_MAX;
+    for (auto &slot : s_slots) {
+        uint64_t epoch = slot.epoch.load(std::memory_order_relaxed);
+        if (epoch && epoch < min) {
+            min = epoch;
+        }
+    }
+    //epoch不小于登记时epoch的读者是在旧指针被替换之后进入的
+    auto keep = list.items.begin();
+    for (auto it = list.items.begin(); it != list.items.end(); ++it) {
+        if (it->epoch < min) {
+            out.push_back(std::move(*it));
+        }
+        else {
+            *keep++ = std::move(*it);
+        }
+    }
+    list.items.erase(keep, list.items.end());
+}
+
+}
+
+void LogRcu::Enter() {
+    if (t_depth++) {
+        return;
+    }
+    RcuSlot *slot = t_slot;
+    if (KAFKA_UNLIKELY(!slot) && !t_noSlot) {
+        slot = claimSlot();
+    }
+    if (KAFKA_LIKELY(slot != nullptr)) {
+        slot->epoch.store(s_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+    else {
+        s_overflowReaders.fetch_add(1, std::memory_order_relaxed);
+    }
+    //先登记再读取发布的指针
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void LogRcu::Exit() {
+    if (--t_depth) {
+        return;
+    }
+    if (KAFKA_LIKELY(t_slot != nullptr)) {
+        t_slot->epoch.store(0, std::memory_order_release);
+    }
+    else {
+        s_overflowReaders.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void LogRcu::Retire(std::function<void()> deleter) {
+    std::vector<Retired> freed;
+    {
+        RetiredList &list = retiredList();
+        std::lock_guard<std::mutex> lock(list.mutex);
+        //调用前已发布新指针，之后进入的读者记录的epoch更大
+        list.items.push_back(Retired{s_epoch.fetch_add(1, std::memory_order_acq_rel), std::move(deleter)});
+        collect(list, freed);
+    }
+    for (auto &item : freed) {
+        item.deleter();
+    }
+}
+
+void LogRcu::Reclaim() {
+    std::vector<Retired> freed;
+    {
+        RetiredList &list = retiredList();
+        std::lock_guard<std::mutex> lock(list.mutex);
+        collect(list, freed);
+    }
+    for (auto &item : freed) {
+        item.deleter();
+    }
+}
+
+KAFKA_NAMESPACE_END
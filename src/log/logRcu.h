@@ -0,0 +1,64 @@
+/**
+ * @file logRcu.h
+ * @brief 日志路径上只读快照的延迟释放
+ * @author ziv
+ * @email
+ * @date 22-11-24.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGRCU_H
+#define KAFKA_LOGRCU_H
+
+#include <stdint.h>
+#include <functional>
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 基于epoch的延迟释放
+ * @details 读者进入临界区时只在自己线程的槽位记录当前epoch，不加锁，也不修改其他线程共享的计数。
+ *          写者发布新的裸指针后调用Retire登记旧对象，进入临界区时可能读到旧指针的读者全部离开后才释放。
+ *          槽位用完后，新线程改用一个共享计数，此时只要有这样的读者在临界区内就不释放任何对象
+ */
+class LogRcu {
+public:
+    /**
+     * @brief 读临界区，可以嵌套，临界区内读到的指针在离开前一直有效
+     */
+    class ReadGuard : noncopyable {
+    public:
+        ReadGuard() {LogRcu::Enter();}
+
+        ~ReadGuard() {LogRcu::Exit();}
+    };
+
+    /**
+     * @brief 登记已经不再发布的对象，当前没有可能读到它的读者时立即释放，否则由之后的Retire或Reclaim释放
+     * @param deleter 释放对象的函数，在不持有任何锁时调用
+     */
+    static void Retire(std::function<void()> deleter);
+
+    template<class T>
+    static void Retire(const T *ptr) {
+        if (ptr) {
+            Retire([ptr]() {delete ptr;});
+        }
+    }
+
+    /**
+     * @brief 释放已经没有读者的对象，由LoggerManager的定时线程调用
+     */
+    static void Reclaim();
+
+private:
+    static void Enter();
+
+    static void Exit();
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGRCU_H
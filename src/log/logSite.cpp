@@ -0,0 +1,124 @@
+/**
+ * @file logSite.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-17.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logSite.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+KAFKA_NAMESPACE_BEGIN
+
+LogSite::LogSite(const char *file, int32_t line, const char *function, LogLevel::Level level, const char *format)
+    : m_file(file), m_line(line), m_function(function), m_level(level), m_format(format),
+      m_enabled(true), m_argTypes(nullptr), m_binaryWriter(0), m_calls(0), m_lastPass(0), m_suppressed(0) {
+    m_id = LogSiteMgr::GetInstance()->add(this);
+}
+
+bool LogSite::everyMs(uint64_t ms) {
+    //加1避免第一次调用时与初始值0冲突
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() + 1;
+    uint64_t last = m_lastPass.load(std::memory_order_relaxed);
+    if ((last == 0 || now - last >= ms)
+        && m_lastPass.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        return true;
+    }
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool LogSite::sampled(double p) {
+    //每个线程独立的xorshift64*
+    static thread_local uint64_t t_state = 0;
+    if (KAFKA_UNLIKELY(t_state == 0)) {
+        t_state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    }
+    t_state ^= t_state >> 12;
+    t_state ^= t_state << 25;
+    t_state ^= t_state >> 27;
+    uint64_t r = t_state * 0x2545F4914F6CDD1DULL;
+    if ((r >> 11) * (1.0 / 9007199254740992.0) < p) {
+        return true;
+    }
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+uint32_t LogSiteRegistry::add(LogSite *site) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sites.push_back(site);
+    for (auto &item : m_rules) {
+        if (Match(*site, item)) {
+            site->setEnabled(item.enabled);
+        }
+    }
+    return static_cast<uint32_t>(m_sites.size());
+}
+
+LogSite* LogSiteRegistry::get(uint32_t id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return id > 0 && id <= m_sites.size() ? m_sites[id - 1] : nullptr;
+}
+
+bool LogSiteRegistry::setEnabled(uint32_t id, bool enabled) {
+    LogSite *site = get(id);
+    if (!site) {
+        return false;
+    }
+    site->setEnabled(enabled);
+    return true;
+}
+
+size_t LogSiteRegistry::setEnabled(const std::string &file, int32_t line, bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Rule rule{file, line, enabled};
+    //同一位置的旧规则被覆盖
+    for (auto it = m_rules.begin(); it != m_rules.end(); ++it) {
+        if (it->file == file && it->line == line) {
+            m_rules.erase(it);
+            break;
+        }
+    }
+    m_rules.push_back(rule);
+
+    size_t count = 0;
+    for (auto item : m_sites) {
+        if (Match(*item, rule)) {
+            item->setEnabled(enabled);
+            ++count;
+        }
+    }
+    return count;
+}
+
+void LogSiteRegistry::visit(const std::function<void(LogSite&)> &cb) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto item : m_sites) {
+        cb(*item);
+    }
+}
+
+size_t LogSiteRegistry::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sites.size();
+}
+
+bool LogSiteRegistry::Match(const LogSite &site, const Rule &rule) {
+    if (rule.line && rule.line != site.getLine()) {
+        return false;
+    }
+    size_t len = strlen(site.getFile());
+    if (len < rule.file.size() || rule.file.compare(0, rule.file.size(), site.getFile() + len - rule.file.size()) != 0) {
+        return false;
+    }
+    //只在路径分隔处匹配，"og.cpp" 不匹配 "log.cpp"
+    return len == rule.file.size() || rule.file[0] == '/' || site.getFile()[len - rule.file.size() - 1] == '/';
+}
+
+KAFKA_NAMESPACE_END
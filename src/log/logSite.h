@@ -0,0 +1,92 @@
+/**
+ * @file logSite.h
+ * @brief 日志调用点登记表
+ * @author ziv
+ * @email
+ * @date 22-11-17.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGSITE_H
+#define KAFKA_LOGSITE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "log.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+#include "../basic/singleton.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 调用点登记表
+ * @details 按文件、行号设置的开关同时作为规则保留，之后才第一次执行的调用点登记时也会应用
+ */
+class LogSiteRegistry : noncopyable {
+public:
+    /**
+     * @brief 登记调用点，由LogSite构造函数调用
+     * @return 调用点id，从1开始连续分配
+     */
+    uint32_t add(LogSite *site);
+
+    /**
+     * @brief 按id查找调用点
+     * @return 不存在时返回nullptr
+     */
+    LogSite* get(uint32_t id);
+
+    /**
+     * @brief 按id设置调用点开关
+     * @return 调用点是否存在
+     */
+    bool setEnabled(uint32_t id, bool enabled);
+
+    /**
+     * @brief 按文件和行号设置调用点开关
+     * @param file 文件名，匹配调用点文件路径的结尾，如 "log.cpp" 或 "src/log/log.cpp"
+     * @param line 行号，为0时匹配文件中的所有调用点
+     * @param enabled
+     * @return 已登记的调用点中被设置的数量
+     */
+    size_t setEnabled(const std::string &file, int32_t line, bool enabled);
+
+    /**
+     * @brief 遍历已登记的调用点
+     */
+    void visit(const std::function<void(LogSite&)> &cb);
+
+    /**
+     * @brief 已登记的调用点数量
+     */
+    size_t size();
+
+private:
+    /**
+     * @brief 按文件和行号设置的开关
+     */
+    struct Rule {
+        std::string file;
+        int32_t line;
+        bool enabled;
+    };
+
+    static bool Match(const LogSite &site, const Rule &rule);
+
+private:
+    std::mutex m_mutex;
+    //下标为id - 1
+    std::vector<LogSite*> m_sites;
+    std::vector<Rule> m_rules;
+};
+
+//调用点登记表的单例模式
+typedef KAFKA::Singleton<LogSiteRegistry> LogSiteMgr;
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGSITE_H
@@ -0,0 +1,96 @@
+/**
+ * @file logStaging.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-5.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "logStaging.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+namespace {
+
+/**
+ * @brief 持有线程的暂存缓冲区，线程退出时刷新并注销
+ */
+struct LogStagingHolder {
+    LogStagingHolder() : buffer(new LogStagingBuffer) {
+        LoggerMgr::GetInstance()->addStagingBuffer(buffer);
+    }
+
+    ~LogStagingHolder() {
+        buffer->flush();
+        LoggerMgr::GetInstance()->delStagingBuffer(buffer);
+    }
+
+    LogStagingBuffer::LogStagingBufferPtr buffer;
+};
+
+}
+
+LogStagingBuffer* LogStagingBuffer::GetThis() {
+    static thread_local LogStagingHolder t_holder;
+    return t_holder.buffer.get();
+}
+
+void LogStagingBuffer::append(LogAppender *appender, const char *data, size_t len) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Batch *batch = nullptr;
+    for (auto &item : m_batches) {
+        if (item.key == appender && !item.appender.expired()) {
+            batch = &item;
+            break;
+        }
+    }
+    if (!batch) {
+        m_batches.push_back(Batch());
+        batch = &m_batches.back();
+        batch->key = appender;
+        batch->appender = appender->shared_from_this();
+    }
+    if (!batch->pending) {
+        batch->pending = appender->shared_from_this();
+    }
+
+    batch->data.append(data, len);
+    if (batch->data.size() >= LoggerMgr::GetInstance()->getStagingThreshold()) {
+        //调用方持有appender，这里不会析构
+        handoff(*batch);
+    }
+}
+
+void LogStagingBuffer::flush() {
+    //appender的析构可能再次进入暂存缓冲区，在释放m_mutex后进行
+    std::vector<LogAppender::LogAppenderPtr> released;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_batches.begin(); it != m_batches.end();) {
+        LogAppender::LogAppenderPtr appender = handoff(*it);
+        if (appender) {
+            released.push_back(std::move(appender));
+        }
+        //appender已经析构，不再为其保留暂存
+        if (it->appender.expired()) {
+            it = m_batches.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+LogAppender::LogAppenderPtr LogStagingBuffer::handoff(Batch &batch) {
+    if (batch.data.empty()) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(batch.pending->m_mutex);
+        batch.pending->writeBuffer(batch.data.c_str(), batch.data.size());
+    }
+    batch.data.clear();
+    return std::move(batch.pending);
+}
+
+KAFKA_NAMESPACE_END
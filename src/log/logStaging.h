@@ -0,0 +1,76 @@
+/**
+ * @file logStaging.h
+ * @brief 线程日志暂存缓冲区
+ * @author ziv
+ * @email
+ * @date 22-11-5.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGSTAGING_H
+#define KAFKA_LOGSTAGING_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "log.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 线程日志暂存缓冲区
+ * @details 每个线程一份，按appender收集格式化好的日志，
+ *          超过LoggerManager::getStagingThreshold()或定时线程刷新时整批交给appender，
+ *          多个线程同时写日志时不再逐条争用appender的锁
+ */
+class LogStagingBuffer : noncopyable {
+public:
+    typedef std::shared_ptr<LogStagingBuffer> LogStagingBufferPtr;
+
+    /**
+     * @brief 获取当前线程的暂存缓冲区，首次调用时向LoggerManager登记
+     */
+    static LogStagingBuffer* GetThis();
+
+    /**
+     * @brief 暂存一条格式化后的日志
+     * @param appender 输出目标
+     * @param data
+     * @param len
+     */
+    void append(LogAppender *appender, const char *data, size_t len);
+
+    /**
+     * @brief 把暂存的日志全部交给输出目标
+     */
+    void flush();
+
+private:
+    struct Batch {
+        //用于查找，appender释放后地址可能被复用，需同时检查appender是否过期
+        LogAppender *key = nullptr;
+        std::weak_ptr<LogAppender> appender;
+        //有暂存的日志时持有appender，交付后释放，不妨碍appender在删除后析构
+        LogAppender::LogAppenderPtr pending;
+        std::string data;
+    };
+
+    /**
+     * @brief 交付一批日志，调用时已持有m_mutex
+     * @return 交付前持有的appender，由调用方在释放m_mutex后析构
+     */
+    static LogAppender::LogAppenderPtr handoff(Batch &batch);
+
+private:
+    //仅与定时刷新线程竞争
+    std::mutex m_mutex;
+    //每个appender一批，线程涉及的appender很少，顺序查找即可
+    std::vector<Batch> m_batches;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGSTAGING_H
@@ -0,0 +1,357 @@
+/**
+ * @file logStream.h
+ * @brief 日志内容流
+ * @author ziv
+ * @email
+ * @date 22-11-10.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_LOGSTREAM_H
+#define KAFKA_LOGSTREAM_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string>
+#include <sstream>
+#include <memory>
+#include "logBuffer.h"
+#include "logFields.h"
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+#include "../basic/stringView.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+//日志内容的内部存储大小，大部分日志不超过该长度
+const size_t kLogStreamInlineSize = 256;
+
+/**
+ * @brief 日志内容流
+ * @details 兼容 operator<< 的写法，内容写入内部存储，超长时才转移到堆上。
+ *          基本类型直接格式化，其他类型通过其 std::ostream 的 operator<< 输出。
+ *          std::hex、std::setw等操纵符的状态保存在内部的ostream中，与std::ostream一样对之后的输出持续生效，
+ *          状态不是默认值时基本类型也通过该ostream格式化
+ */
+class LogStream : noncopyable {
+public:
+    typedef InlineBuffer<kLogStreamInlineSize> Buffer;
+
+    LogStream& operator<<(bool v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.append(v ? '1' : '0');
+        return *this;
+    }
+
+    LogStream& operator<<(char v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.append(v);
+        return *this;
+    }
+
+    LogStream& operator<<(signed char v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.append(static_cast<char>(v));
+        return *this;
+    }
+
+    LogStream& operator<<(unsigned char v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.append(static_cast<char>(v));
+        return *this;
+    }
+
+    LogStream& operator<<(short v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(unsigned short v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendUInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(int v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(unsigned int v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendUInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(long v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(unsigned long v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendUInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(long long v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(unsigned long long v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        m_buffer.appendUInt(v);
+        return *this;
+    }
+
+    LogStream& operator<<(float v) {
+        return *this << static_cast<double>(v);
+    }
+
+    LogStream& operator<<(double v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        //与std::ostream默认精度保持一致
+        char *p = m_buffer.reserve(32);
+        m_buffer.commit(snprintf(p, 32, "%g", v));
+        return *this;
+    }
+
+    LogStream& operator<<(long double v) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(v);
+        }
+        char *p = m_buffer.reserve(64);
+        m_buffer.commit(snprintf(p, 64, "%Lg", v));
+        return *this;
+    }
+
+    LogStream& operator<<(const char *str) {
+        if (KAFKA_UNLIKELY(m_stateful) && str) {
+            return formatted(str);
+        }
+        if (str) {
+            m_buffer.append(str);
+        }
+        else {
+            m_buffer.append("(null)", 6);
+        }
+        return *this;
+    }
+
+    LogStream& operator<<(char *str) {
+        return *this << static_cast<const char*>(str);
+    }
+
+    LogStream& operator<<(const std::string &str) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(str);
+        }
+        m_buffer.append(str.data(), str.size());
+        return *this;
+    }
+
+    LogStream& operator<<(const StringView &str) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(str.toString());
+        }
+        m_buffer.append(str.data(), str.size());
+        return *this;
+    }
+
+    LogStream& operator<<(const void *p) {
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            return formatted(p);
+        }
+        if (!p) {
+            m_buffer.append('0');
+            return *this;
+        }
+        static const char s_hex[] = "0123456789abcdef";
+        uintptr_t v = reinterpret_cast<uintptr_t>(p);
+        char tmp[2 + sizeof(uintptr_t) * 2];
+        char *end = tmp + sizeof(tmp);
+        char *cur = end;
+        do {
+            *--cur = s_hex[v & 0xf];
+            v >>= 4;
+        } while (v);
+        *--cur = 'x';
+        *--cur = '0';
+        m_buffer.append(cur, end - cur);
+        return *this;
+    }
+
+    /**
+     * @brief 键值字段写入所属事件的字段表，没有所属事件时按 " key=value" 写入内容
+     */
+    LogStream& operator<<(const LogField &field) {
+        if (m_fields) {
+            m_fields->add(field);
+        }
+        else {
+            m_buffer.append(' ');
+            m_buffer.append(field.getKey().data(), field.getKey().size());
+            m_buffer.append('=');
+            field.appendValue(m_buffer);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief std::endl、std::flush等操纵符，按std::ostream的输出结果写入
+     */
+    LogStream& operator<<(std::ostream& (*manip)(std::ostream&)) {
+        return formatted(manip);
+    }
+
+    /**
+     * @brief std::hex、std::fixed、std::boolalpha等操纵符，修改之后输出的格式
+     */
+    LogStream& operator<<(std::ios_base& (*manip)(std::ios_base&)) {
+        manip(stream());
+        m_stateful = !isDefaultState();
+        return *this;
+    }
+
+    /**
+     * @brief 其他类型通过其 std::ostream 的 operator<< 输出，std::setw、std::setprecision等也从这里修改格式
+     */
+    template<class T>
+    LogStream& operator<<(const T &value) {
+        formatted(value);
+        m_stateful = !isDefaultState();
+        return *this;
+    }
+
+    /**
+     * @brief 写入原始数据
+     */
+    LogStream& write(const char *data, size_t len) {
+        m_buffer.append(data, len);
+        return *this;
+    }
+
+    /**
+     * @brief printf风格格式化写入，优先直接写入剩余的内部存储
+     * @param fmt
+     * @param al
+     */
+    void vformat(const char *fmt, va_list al) {
+        va_list copy;
+        va_copy(copy, al);
+        size_t avail = m_buffer.avail();
+        int len = vsnprintf(m_buffer.reserve(0), avail, fmt, al);
+        if (len >= 0 && static_cast<size_t>(len) < avail) {
+            m_buffer.commit(len);
+        }
+        else if (len >= 0) {
+            vsnprintf(m_buffer.reserve(len + 1), len + 1, fmt, copy);
+            m_buffer.commit(len);
+        }
+        va_end(copy);
+    }
+
+    /**
+     * @brief 内容的引用，不拷贝
+     */
+    StringView view() const {return StringView(m_buffer.data(), m_buffer.size());}
+
+    std::string str() const {return m_buffer.toString();}
+
+    size_t size() const {return m_buffer.size();}
+
+    /**
+     * @brief 清空内容和操纵符设置的格式，保留已分配的空间
+     */
+    void clear() {
+        m_buffer.clear();
+        if (KAFKA_UNLIKELY(m_stateful)) {
+            resetState();
+        }
+    }
+
+    /**
+     * @brief 设置键值字段的写入位置，由LogEvent设置
+     */
+    void setFields(LogFields *fields) {m_fields = fields;}
+
+private:
+    /**
+     * @brief 保存格式状态的ostream，第一次需要时创建
+     */
+    std::ostringstream& stream() {
+        if (!m_os) {
+            m_os.reset(new std::ostringstream);
+        }
+        return *m_os;
+    }
+
+    /**
+     * @brief 通过内部ostream按当前格式输出
+     */
+    template<class T>
+    LogStream& formatted(const T &value) {
+        std::ostringstream &os = stream();
+        os.str(std::string());
+        os << value;
+        std::string str = os.str();
+        m_buffer.append(str.data(), str.size());
+        return *this;
+    }
+
+    bool isDefaultState() const {
+        return !m_os || (m_os->flags() == (std::ios_base::dec | std::ios_base::skipws) && m_os->width() == 0
+                         && m_os->precision() == 6 && m_os->fill() == ' ');
+    }
+
+    void resetState() {
+        m_os->flags(std::ios_base::dec | std::ios_base::skipws);
+        m_os->width(0);
+        m_os->precision(6);
+        m_os->fill(' ');
+        m_stateful = false;
+    }
+
+private:
+    Buffer m_buffer;
+    LogFields *m_fields = nullptr;
+    //操纵符设置了非默认的格式
+    bool m_stateful = false;
+    std::unique_ptr<std::ostringstream> m_os;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_LOGSTREAM_H
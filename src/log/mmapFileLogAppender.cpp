@@ -0,0 +1,209 @@
+/**
+ * @file mmapFileLogAppender.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-15.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "mmapFileLogAppender.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+KAFKA_NAMESPACE_BEGIN
+
+namespace {
+
+/**
+ * @brief 文件的有效长度，跳过上次崩溃时预分配但未写入的'\0'
+ */
+uint64_t contentSize(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        return 0;
+    }
+    uint64_t end = st.st_size;
+    std::vector<char> buf(64 * 1024);
+    while (end > 0) {
+        uint64_t begin = end > buf.size() ? end - buf.size() : 0;
+        ssize_t n = ::pread(fd, &buf[0], end - begin, begin);
+        if (n != static_cast<ssize_t>(end - begin)) {
+            return st.st_size;
+        }
+        for (ssize_t i = n - 1; i >= 0; --i) {
+            if (buf[i] != '\0') {
+                return begin + i + 1;
+            }
+        }
+        end = begin;
+    }
+    return 0;
+}
+
+}
+
+MmapFileLogAppender::MmapFileLogAppender(const std::string &filename, size_t windowSize)
+    : m_filename(filename), m_failed(false), m_offset(0) {
+    uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    m_windowSize = (windowSize + page - 1) / page * page;
+    for (auto &item : m_windows) {
+        item.index.store(kUnmapped, std::memory_order_relaxed);
+        item.committed.store(0, std::memory_order_relaxed);
+    }
+
+    m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        m_failed = true;
+        return;
+    }
+    uint64_t offset = contentSize(m_fd);
+    m_offset.store(offset, std::memory_order_relaxed);
+
+    uint64_t first = offset / m_windowSize;
+    for (uint64_t i = first; i < first + kWindowSlots; ++i) {
+        Window &window = m_windows[i % kWindowSlots];
+        window.base = mapWindow(i);
+        if (!window.base) {
+            m_failed = true;
+            return;
+        }
+        window.committed.store(i == first ? offset - first * m_windowSize : 0, std::memory_order_relaxed);
+        window.index.store(i, std::memory_order_release);
+    }
+    //写入线程可能在后台线程启动前已经预留了位置，不能在后台线程中按m_offset计算
+    m_thread = std::thread(&MmapFileLogAppender::backgroundFunc, this, first + kWindowSlots);
+}
+
+MmapFileLogAppender::~MmapFileLogAppender() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_bgMutex);
+            m_running = false;
+        }
+        m_cond.notify_one();
+        m_thread.join();
+    }
+    uint64_t end = committedEnd();
+    for (auto &item : m_windows) {
+        if (item.base) {
+            ::munmap(item.base, m_windowSize);
+        }
+    }
+    if (m_fd >= 0) {
+        //去掉预分配未使用的部分和失败后放弃的预留位置，截断失败时文件末尾保留'\0'
+        int rv = ::ftruncate(m_fd, end);
+        (void)rv;
+        ::close(m_fd);
+    }
+}
+
+void MmapFileLogAppender::logFormatted(LogLevel::Level level, const char *data, size_t len) {
+    write(data, len);
+}
+
+void MmapFileLogAppender::writeBuffer(const char *data, size_t len) {
+    write(data, len);
+}
+
+std::string MmapFileLogAppender::toYamlString() {
+    return "";
+}
+
+void MmapFileLogAppender::write(const char *data, size_t len) {
+    if (KAFKA_UNLIKELY(m_failed.load(std::memory_order_relaxed)) || len == 0) {
+        return;
+    }
+    uint64_t offset = m_offset.fetch_add(len, std::memory_order_relaxed);
+    while (len) {
+        uint64_t index = offset / m_windowSize;
+        uint64_t pos = offset - index * m_windowSize;
+        size_t n = static_cast<size_t>(std::min<uint64_t>(len, m_windowSize - pos));
+        Window &window = m_windows[index % kWindowSlots];
+
+        //写入速度超过后台线程映射速度时等待
+        while (KAFKA_UNLIKELY(window.index.load(std::memory_order_acquire) != index)) {
+            if (m_failed.load(std::memory_order_relaxed)) {
+                return;
+            }
+            m_cond.notify_one();
+            std::this_thread::yield();
+        }
+        memcpy(window.base + pos, data, n);
+        if (window.committed.fetch_add(n, std::memory_order_acq_rel) + n == m_windowSize) {
+            //窗口已写满，通知后台线程换下一个窗口
+            std::lock_guard<std::mutex> lock(m_bgMutex);
+            m_cond.notify_one();
+        }
+        offset += n;
+        data += n;
+        len -= n;
+    }
+}
+
+uint64_t MmapFileLogAppender::committedEnd() const {
+    uint64_t end = m_offset.load(std::memory_order_acquire);
+    //已映射的窗口中预留的位置都已写完，之前的窗口写满后才解除映射
+    uint64_t lowest = kUnmapped;
+    for (auto &item : m_windows) {
+        lowest = std::min(lowest, item.index.load(std::memory_order_acquire));
+    }
+    if (lowest == kUnmapped) {
+        return end;
+    }
+    uint64_t gap = lowest;
+    while (gap < lowest + kWindowSlots && m_windows[gap % kWindowSlots].index.load(std::memory_order_acquire) == gap) {
+        ++gap;
+    }
+    return std::min(end, gap * m_windowSize);
+}
+
+char* MmapFileLogAppender::mapWindow(uint64_t index) {
+    off_t begin = static_cast<off_t>(index * m_windowSize);
+    off_t end = begin + static_cast<off_t>(m_windowSize);
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        return nullptr;
+    }
+    //映射超出文件长度的部分访问时会SIGBUS，先扩展文件
+    if (st.st_size < end
+        && ::fallocate(m_fd, 0, begin, m_windowSize) != 0
+        && ::ftruncate(m_fd, end) != 0) {
+        return nullptr;
+    }
+    void *addr = ::mmap(nullptr, m_windowSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, begin);
+    return addr == MAP_FAILED ? nullptr : static_cast<char*>(addr);
+}
+
+void MmapFileLogAppender::backgroundFunc(uint64_t next) {
+    std::unique_lock<std::mutex> lock(m_bgMutex);
+    while (m_running) {
+        Window &window = m_windows[next % kWindowSlots];
+        if (window.committed.load(std::memory_order_acquire) != m_windowSize) {
+            m_cond.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+        lock.unlock();
+
+        //槽位中的窗口next - kWindowSlots已经写满
+        window.index.store(kUnmapped, std::memory_order_relaxed);
+        ::munmap(window.base, m_windowSize);
+        window.base = mapWindow(next);
+        if (!window.base) {
+            m_failed = true;
+            return;
+        }
+        window.committed.store(0, std::memory_order_relaxed);
+        window.index.store(next, std::memory_order_release);
+        ++next;
+
+        lock.lock();
+    }
+}
+
+KAFKA_NAMESPACE_END
@@ -0,0 +1,122 @@
+/**
+ * @file mmapFileLogAppender.h
+ * @brief 内存映射文件输出
+ * @author ziv
+ * @email
+ * @date 22-11-15.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_MMAPFILELOGAPPENDER_H
+#define KAFKA_MMAPFILELOGAPPENDER_H
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "log.h"
+#include "../basic/basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 内存映射文件输出
+ * @details 文件按窗口(windowSize字节)映射，同时映射kWindowSlots个连续窗口。
+ *          写入线程用原子fetch-add在文件中预留位置，直接memcpy到映射区，不加锁也没有write系统调用。
+ *          窗口内的字节全部写完后，由后台线程解除映射，用fallocate扩展文件并映射后面的窗口。
+ *          写入的内容在进程崩溃后仍保留在页缓存中，文件末尾可能有未写入的'\0'；正常关闭时截断到连续写入内容的末尾。
+ *          不使用暂存缓冲区
+ */
+class MmapFileLogAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<MmapFileLogAppender> MmapFileLogAppenderPtr;
+
+    //同时映射的窗口数
+    static const size_t kWindowSlots = 4;
+
+    /**
+     * @brief
+     * @param filename 文件名，已存在时追加
+     * @param windowSize 窗口大小，按页大小向上取整
+     */
+    explicit MmapFileLogAppender(const std::string &filename, size_t windowSize = 8 * 1024 * 1024);
+
+    ~MmapFileLogAppender() override;
+
+    void logFormatted(LogLevel::Level level, const char *data, size_t len) override;
+
+    std::string toYamlString() override;
+
+    /**
+     * @brief 是否可以写入，文件打开、映射或扩展失败后为false，之后的日志被丢弃
+     */
+    bool isOk() const {return !m_failed.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 已写入的字节数(含打开时文件已有的内容)
+     */
+    uint64_t getOffset() const {return m_offset.load(std::memory_order_relaxed);}
+
+protected:
+    void writeBuffer(const char *data, size_t len) override;
+
+private:
+    /**
+     * @brief 预留位置并写入，可多线程同时调用
+     */
+    void write(const char *data, size_t len);
+
+    /**
+     * @brief 映射一个窗口，文件长度不足时先扩展
+     * @return 映射地址，失败返回nullptr
+     */
+    char* mapWindow(uint64_t index);
+
+    /**
+     * @brief 连续写入内容的末尾，在所有写入线程结束后调用
+     * @details 映射失败后，预留在未映射窗口中的位置没有写入，从第一个未映射的窗口开始都不算
+     */
+    uint64_t committedEnd() const;
+
+    /**
+     * @brief 后台线程
+     * @param next 下一个要映射的窗口
+     */
+    void backgroundFunc(uint64_t next);
+
+private:
+    /**
+     * @brief 窗口槽位，窗口index映射在第 index % kWindowSlots 个槽位
+     */
+    struct Window {
+        //当前映射的窗口序号，槽位切换期间为kUnmapped
+        std::atomic<uint64_t> index;
+        char *base = nullptr;
+        //已写入的字节数，等于窗口大小时可以解除映射
+        std::atomic<uint64_t> committed;
+        char pad[64];
+    };
+
+    static const uint64_t kUnmapped = ~0ULL;
+
+    std::string m_filename;
+    int m_fd = -1;
+    uint64_t m_windowSize;
+    std::atomic<bool> m_failed;
+    //写入位置，独占缓存行
+    char m_pad0[64];
+    std::atomic<uint64_t> m_offset;
+    char m_pad1[64];
+    Window m_windows[kWindowSlots];
+
+    //后台线程等待窗口写满
+    std::mutex m_bgMutex;
+    std::condition_variable m_cond;
+    bool m_running = true;
+    std::thread m_thread;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_MMAPFILELOGAPPENDER_H
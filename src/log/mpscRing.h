@@ -0,0 +1,131 @@
+/**
+ * @file mpscRing.h
+ * @brief 有界无锁多生产者单消费者环形队列
+ * @author ziv
+ * @email
+ * @date 22-11-4.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_MPSCRING_H
+#define KAFKA_MPSCRING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "../basic/basicDefine.h"
+#include "../basic/noncopyable.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+const size_t kCacheLineSize = 64;
+
+/**
+ * @brief 有界多生产者单消费者环形队列
+ * @details 每个槽位带一个序号，生产者通过CAS抢占写入位置，不使用互斥锁；
+ *          消费者只有一个，读取位置无需原子竞争。写、读位置分别独占一条cache line
+ * @tparam T 元素类型，需要可默认构造和移动
+ */
+template<class T>
+class MpscRing : noncopyable {
+public:
+    /**
+     * @brief
+     * @param capacity 容量，向上取整到2的幂
+     */
+    explicit MpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_cells = new Cell[size];
+        for (size_t i = 0; i < size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_tail.store(0, std::memory_order_relaxed);
+        m_head = 0;
+    }
+
+    ~MpscRing() {
+        delete[] m_cells;
+    }
+
+    /**
+     * @brief 生产者写入，队列满时返回false
+     * @param value 元素
+     * @return 是否写入成功
+     */
+    bool tryPush(T &&value) {
+        Cell *cell;
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 消费者读取，只能在单一线程调用，队列空时返回false
+     * @param value 读出的元素
+     * @return 是否读取成功
+     */
+    bool tryPop(T &value) {
+        Cell *cell = &m_cells[m_head & m_mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(m_head + 1) < 0) {
+            return false;
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        ++m_head;
+        return true;
+    }
+
+    /**
+     * @brief 消费者视角下队列是否为空
+     */
+    bool empty() const {
+        const Cell *cell = &m_cells[m_head & m_mask];
+        return static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire))
+               - static_cast<intptr_t>(m_head + 1) < 0;
+    }
+
+    size_t capacity() const {return m_mask + 1;}
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    char m_pad0[kCacheLineSize];
+    Cell *m_cells;
+    size_t m_mask;
+    char m_pad1[kCacheLineSize - sizeof(Cell*) - sizeof(size_t)];
+    //生产者写入位置
+    std::atomic<size_t> m_tail;
+    char m_pad2[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    //消费者读取位置
+    size_t m_head;
+    char m_pad3[kCacheLineSize - sizeof(size_t)];
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_MPSCRING_H
@@ -0,0 +1,252 @@
+/**
+ * @file rollingFileLogAppender.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-14.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "rollingFileLogAppender.h"
+#include "logCompress.h"
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+KAFKA_NAMESPACE_BEGIN
+
+namespace {
+
+//IO优先级设置为idle
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassIdle = 3;
+const int kIoprioClassShift = 13;
+
+bool exists(const std::string &path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+/**
+ * @brief 释放文件末尾之后预分配但没有写入的空间，截断到当前大小即可，ext4上打洞不会释放末尾之后的空间
+ */
+void releaseReserved(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        ::ftruncate(fd, st.st_size);
+    }
+}
+}
+
+RollingFileLogAppender::RollingFileLogAppender(const std::string &filename, uint64_t rollSize,
+                                               uint32_t rollInterval, bool compress)
+    : m_filename(filename), m_rollSize(rollSize), m_rollInterval(rollInterval), m_compress(compress) {
+    time_t now = time(nullptr);
+    m_thread = std::thread(&RollingFileLogAppender::backgroundFunc, this);
+    openFile(now);
+}
+
+RollingFileLogAppender::~RollingFileLogAppender() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        flushBuffer();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        m_running = false;
+    }
+    m_taskCond.notify_one();
+    m_thread.join();
+
+    if (m_fd >= 0) {
+        releaseReserved(m_fd);
+        ::close(m_fd);
+    }
+    if (m_nextFd >= 0) {
+        //释放预留的空间
+        ::close(m_nextFd);
+        ::unlink((m_filename + ".next").c_str());
+    }
+}
+
+std::string RollingFileLogAppender::toYamlString() {
+    return "";
+}
+
+void RollingFileLogAppender::roll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    flushBuffer();
+    SignalGuard guard(m_signalBusy);
+    rollFile(time(nullptr));
+}
+
+void RollingFileLogAppender::waitBackground() {
+    std::unique_lock<std::mutex> lock(m_taskMutex);
+    m_idleCond.wait(lock, [this]() {return m_tasks.empty() && !m_busy;});
+}
+
+void RollingFileLogAppender::writeOutput(const char *data, size_t len) {
+    time_t now = time(nullptr);
+    if (m_fd < 0 || (m_rollAt && now >= m_rollAt)) {
+        rollFile(now);
+    }
+    while (len) {
+        size_t n = len;
+        if (m_rollSize && m_size + len > m_rollSize) {
+            //批量写出时在行尾切分，保证单个文件不超过rollSize
+            size_t room = m_size < m_rollSize ? static_cast<size_t>(m_rollSize - m_size) : 0;
+            const char *end = room ? static_cast<const char*>(memrchr(data, '\n', std::min(room, len))) : nullptr;
+            if (end) {
+                n = end - data + 1;
+            }
+            else if (m_size > 0) {
+                rollFile(now);
+                continue;
+            }
+        }
+        if (m_fd < 0) {
+            return;
+        }
+        size_t left = n;
+        while (left) {
+            ssize_t rt = ::write(m_fd, data, left);
+            if (rt < 0 && errno == EINTR) {
+                continue;
+            }
+            if (rt <= 0) {
+                return;
+            }
+            data += rt;
+            left -= rt;
+            m_size += rt;
+        }
+        len -= n;
+    }
+}
+
+time_t RollingFileLogAppender::nextRollTime(time_t now) const {
+    if (!m_rollInterval) {
+        return 0;
+    }
+    struct tm tm;
+    localtime_r(&now, &tm);
+    int64_t boundary = (static_cast<int64_t>(now) + tm.tm_gmtoff) / m_rollInterval * m_rollInterval + m_rollInterval;
+    time_t at = static_cast<time_t>(boundary - tm.tm_gmtoff);
+    //边界处于夏令时切换之后时按边界处的偏移对齐
+    localtime_r(&at, &tm);
+    time_t aligned = static_cast<time_t>(boundary - tm.tm_gmtoff);
+    return aligned > now ? aligned : at;
+}
+
+void RollingFileLogAppender::rollFile(time_t now) {
+    if (m_fd >= 0) {
+        //预分配的文件只用了m_size，关闭前归还剩余的空间
+        releaseReserved(m_fd);
+        ::close(m_fd);
+        m_fd = -1;
+        if (m_size > 0) {
+            char suffix[32];
+            struct tm tm;
+            localtime_r(&m_openTime, &tm);
+            strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &tm);
+            std::string archive = m_filename + suffix;
+            for (int i = 1; exists(archive) || exists(archive + ".lz4"); ++i) {
+                archive = m_filename + suffix + "." + std::to_string(i);
+            }
+            if (::rename(m_filename.c_str(), archive.c_str()) == 0 && m_compress) {
+                post(std::bind(&RollingFileLogAppender::compressFile, this, archive));
+            }
+        }
+    }
+    openFile(now);
+}
+
+void RollingFileLogAppender::openFile(time_t now) {
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        std::swap(fd, m_nextFd);
+    }
+    if (fd >= 0 && !exists(m_filename) && ::rename((m_filename + ".next").c_str(), m_filename.c_str()) == 0) {
+        m_fd = fd;
+    }
+    else {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+
+    struct stat st;
+    m_size = (m_fd >= 0 && ::fstat(m_fd, &st) == 0) ? st.st_size : 0;
+    m_openTime = now;
+    m_rollAt = nextRollTime(now);
+    post(std::bind(&RollingFileLogAppender::prepareNext, this));
+}
+
+void RollingFileLogAppender::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_taskCond.notify_one();
+}
+
+void RollingFileLogAppender::backgroundFunc() {
+    pid_t tid = static_cast<pid_t>(::syscall(SYS_gettid));
+    //Linux上nice值按线程生效
+    ::setpriority(PRIO_PROCESS, tid, 19);
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, kIoprioClassIdle << kIoprioClassShift);
+
+    std::unique_lock<std::mutex> lock(m_taskMutex);
+    while (true) {
+        m_taskCond.wait(lock, [this]() {return !m_tasks.empty() || !m_running;});
+        if (m_tasks.empty()) {
+            break;
+        }
+        std::function<void()> task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        m_busy = true;
+        lock.unlock();
+        task();
+        lock.lock();
+        m_busy = false;
+        if (m_tasks.empty()) {
+            m_idleCond.notify_all();
+        }
+    }
+}
+
+void RollingFileLogAppender::prepareNext() {
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        if (m_nextFd >= 0 || !m_running) {
+            return;
+        }
+    }
+    std::string next = m_filename + ".next";
+    int fd = ::open(next.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    if (m_rollSize) {
+        //只预留空间，不改变文件大小，失败(文件系统不支持)时忽略
+        ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(m_rollSize));
+    }
+    std::lock_guard<std::mutex> lock(m_taskMutex);
+    m_nextFd = fd;
+}
+
+void RollingFileLogAppender::compressFile(const std::string &path) {
+    if (LogCompress::CompressFile(path, path + ".lz4")) {
+        ::unlink(path.c_str());
+    }
+}
+
+KAFKA_NAMESPACE_END
@@ -0,0 +1,127 @@
+/**
+ * @file rollingFileLogAppender.h
+ * @brief 按大小和时间滚动的文件输出
+ * @author ziv
+ * @email
+ * @date 22-11-14.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_ROLLINGFILELOGAPPENDER_H
+#define KAFKA_ROLLINGFILELOGAPPENDER_H
+
+#include <string>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "log.h"
+#include "../basic/basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 按大小和时间滚动的文件输出
+ * @details 日志始终写入filename，文件超过rollSize字节或跨过rollInterval秒的边界(按本地时间对齐)时，
+ *          将其改名为 filename.YYYYmmdd-HHMMSS 并切换到新文件，写入线程只做两次rename。
+ *          后台低优先级线程负责:
+ *          1. 预先创建下一个文件(filename.next)并用fallocate预留rollSize空间
+ *          2. 将滚动出的文件压缩为 .lz4 后删除原文件
+ */
+class RollingFileLogAppender : public BufferedLogAppender {
+public:
+    typedef std::shared_ptr<RollingFileLogAppender> RollingFileLogAppenderPtr;
+
+    /**
+     * @brief
+     * @param filename 文件名
+     * @param rollSize 单个文件最大字节数，为0时不按大小滚动
+     * @param rollInterval 滚动间隔(秒)，为0时不按时间滚动
+     * @param compress 是否压缩滚动出的文件
+     */
+    explicit RollingFileLogAppender(const std::string &filename, uint64_t rollSize = 1024 * 1024 * 1024,
+                                    uint32_t rollInterval = 24 * 3600, bool compress = true);
+
+    ~RollingFileLogAppender() override;
+
+    std::string toYamlString() override;
+
+    /**
+     * @brief 立即滚动
+     */
+    void roll();
+
+    /**
+     * @brief 等待后台线程完成已提交的预分配和压缩
+     */
+    void waitBackground();
+
+    const std::string& getFilename() const {return m_filename;}
+
+protected:
+    void writeOutput(const char *data, size_t len) override;
+
+    int getOutputFd() const override {return m_fd;}
+
+private:
+    /**
+     * @brief 滚动当前文件，需持有m_mutex
+     * @param now 当前时间
+     */
+    void rollFile(time_t now);
+
+    /**
+     * @brief 打开filename，优先使用预分配好的文件
+     */
+    void openFile(time_t now);
+
+    /**
+     * @brief 下一个滚动边界，按本地时间对齐，每次打开文件时用当时的时区偏移重新计算
+     * @return 不按时间滚动时返回0
+     */
+    time_t nextRollTime(time_t now) const;
+
+    /**
+     * @brief 提交后台任务
+     */
+    void post(std::function<void()> task);
+
+    void backgroundFunc();
+
+    /**
+     * @brief 后台任务: 预分配下一个文件
+     */
+    void prepareNext();
+
+    /**
+     * @brief 后台任务: 压缩滚动出的文件
+     */
+    void compressFile(const std::string &path);
+
+private:
+    std::string m_filename;
+    uint64_t m_rollSize;
+    uint32_t m_rollInterval;
+    bool m_compress;
+    int m_fd = -1;
+    uint64_t m_size = 0;
+    //当前文件按时间滚动的时刻，0表示不按时间滚动
+    time_t m_rollAt = 0;
+    time_t m_openTime = 0;
+
+    //后台线程
+    std::mutex m_taskMutex;
+    std::condition_variable m_taskCond;
+    std::condition_variable m_idleCond;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_running = true;
+    bool m_busy = false;
+    //预分配好的下一个文件，由m_taskMutex保护
+    int m_nextFd = -1;
+    std::thread m_thread;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_ROLLINGFILELOGAPPENDER_H
@@ -0,0 +1,196 @@
+/**
+ * @file staticLogFormatter.h
+ * @brief 编译期确定pattern的日志格式器
+ * @author ziv
+ * @email
+ * @date 22-11-6.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_STATICLOGFORMATTER_H
+#define KAFKA_STATICLOGFORMATTER_H
+
+#include <string.h>
+#include <string>
+#include "log.h"
+#include "../basic/basicDefine.h"
+
+/**
+ * @brief 声明一个编译期字符串类型，用于 pattern::Literal 和 pattern::DateTime
+ * @details KAFKA_PATTERN_STRING(Arrow, " -> ");
+ *          typedef KAFKA::StaticLogFormatter<..., KAFKA::pattern::Literal<Arrow>, ...> MyFormatter;
+ */
+#define KAFKA_PATTERN_STRING(name, str) \
+    struct name { \
+        static const char* value() {return str;} \
+    }
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 编译期pattern的组成项，与LogFormatter的%xxx一一对应
+ * @details 每一项都是只有静态内联函数的类型，由StaticLogFormatter在编译期展开，没有虚函数调用
+ */
+namespace pattern {
+
+KAFKA_PATTERN_STRING(DefaultTimeFormat, "%Y-%m-%d %H:%M:%S");
+
+//%m 消息
+struct Message {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        StringView content = event->getContent();
+        buf.append(content.data(), content.size());
+        event->getFields().appendText(buf);
+    }
+    static void pattern(std::string &str) {str.append("%m");}
+};
+
+//%p 日志级别
+struct Level {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append(LogLevel::toString(level));
+    }
+    static void pattern(std::string &str) {str.append("%p");}
+};
+
+//%r 累计毫秒数
+struct Elapse {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.appendUInt(event->getElapse());
+    }
+    static void pattern(std::string &str) {str.append("%r");}
+};
+
+//%c 日志名称，与LogFormatter保持一致
+struct Name {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append(event->getThreadName());
+    }
+    static void pattern(std::string &str) {str.append("%c");}
+};
+
+//%t 线程id
+struct ThreadId {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.appendUInt(event->getThreadId());
+    }
+    static void pattern(std::string &str) {str.append("%t");}
+};
+
+//%n 换行
+struct NewLine {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append('\n');
+    }
+    static void pattern(std::string &str) {str.append("%n");}
+};
+
+//%d 时间
+template<class Format = DefaultTimeFormat>
+struct DateTime {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        static const DateTimeFormat s_format(Format::value());
+        s_format.format(buf, event->getWallTime());
+    }
+    static void pattern(std::string &str) {str.append("%d{").append(Format::value()).append("}");}
+};
+
+//%f 文件名
+struct Filename {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append(event->getFile());
+    }
+    static void pattern(std::string &str) {str.append("%f");}
+};
+
+//%l 行号
+struct Line {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.appendInt(event->getLine());
+    }
+    static void pattern(std::string &str) {str.append("%l");}
+};
+
+//%T Tab
+struct Tab {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append('\t');
+    }
+    static void pattern(std::string &str) {str.append("%T");}
+};
+
+//%F 协程id
+struct FiberId {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.appendUInt(event->getFiberId());
+    }
+    static void pattern(std::string &str) {str.append("%F");}
+};
+
+//%N 线程名称
+struct ThreadName {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append(event->getThreadName());
+    }
+    static void pattern(std::string &str) {str.append("%N");}
+};
+
+//单个字符
+template<char C>
+struct Char {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append(C);
+    }
+    static void pattern(std::string &str) {str.append(1, C);}
+};
+
+//普通字符串，Str由KAFKA_PATTERN_STRING声明
+template<class Str>
+struct Literal {
+    static void format(LogBuffer &buf, LogLevel::Level level, const LogEvent::LogEventPtr &event) {
+        buf.append(Str::value(), strlen(Str::value()));
+    }
+    static void pattern(std::string &str) {str.append(Str::value());}
+};
+
+}
+
+/**
+ * @brief 编译期确定pattern的日志格式器
+ * @details pattern由 pattern 命名空间中的项组成，格式化时按顺序内联展开，没有逐项的操作码分派。
+ *          可以像LogFormatter一样设置给Logger或LogAppender，由配置决定的pattern仍使用LogFormatter
+ * @tparam Items pattern组成项
+ */
+template<class... Items>
+class StaticLogFormatter : public LogFormatter {
+public:
+    typedef std::shared_ptr<StaticLogFormatter> StaticLogFormatterPtr;
+
+    StaticLogFormatter() {
+        int dummy[] = {0, (Items::pattern(m_pattern), 0)...};
+        (void)dummy;
+    }
+
+    using LogFormatter::format;
+
+    void format(LogBuffer &buf, const std::shared_ptr<Logger> &logger, LogLevel::Level level, const LogEvent::LogEventPtr &event) override {
+        int dummy[] = {0, (Items::format(buf, level, event), 0)...};
+        (void)dummy;
+    }
+};
+
+/**
+ * @brief 与Logger默认pattern "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n" 等价的编译期格式器
+ */
+typedef StaticLogFormatter<pattern::DateTime<>, pattern::Tab,
+                           pattern::ThreadId, pattern::Tab,
+                           pattern::ThreadName, pattern::Tab,
+                           pattern::FiberId, pattern::Tab,
+                           pattern::Char<'['>, pattern::Level, pattern::Char<']'>, pattern::Tab,
+                           pattern::Char<'['>, pattern::Name, pattern::Char<']'>, pattern::Tab,
+                           pattern::Filename, pattern::Char<':'>, pattern::Line, pattern::Tab,
+                           pattern::Message, pattern::NewLine> DefaultStaticLogFormatter;
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_STATICLOGFORMATTER_H
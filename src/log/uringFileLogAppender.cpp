@@ -0,0 +1,492 @@
+/**
+ * @file uringFileLogAppender.cpp
+ * @brief
+ * @author ziv
+ * @email
+ * @date 22-11-16.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include "uringFileLogAppender.h"
+#include "logStaging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <algorithm>
+#include <chrono>
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief io_uring的提交队列和完成队列，直接使用系统调用，不依赖liburing
+ */
+struct UringFileLogAppender::Uring {
+    int fd = -1;
+    //注册缓冲区成功时使用WRITE_FIXED
+    bool fixed = false;
+
+    void *sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void *cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned *sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+
+    //已放入提交队列尚未提交的数量
+    unsigned unsubmitted = 0;
+
+    ~Uring() {
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            ::munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            ::munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = single ? sqRing
+                        : ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char *sq = static_cast<char*>(sqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char *cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool registerBuffers(const iovec *iov, unsigned count) {
+        fixed = ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, count) == 0;
+        return fixed;
+    }
+
+    /**
+     * @brief 放入一个写请求，调用方保证在途请求数不超过队列长度
+     */
+    void prepareWrite(int file, const char *data, size_t len, uint64_t offset, size_t index) {
+        unsigned tail = *sqTail;
+        unsigned slot = tail & sqMask;
+        io_uring_sqe *sqe = &sqes[slot];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = file;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->off = offset;
+        sqe->buf_index = static_cast<uint16_t>(index);
+        sqe->user_data = index;
+        sqArray[slot] = slot;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted;
+    }
+
+    /**
+     * @brief 提交请求，wait为true时至少等待一个完成
+     * @return 出现不可重试的错误时返回false
+     */
+    bool enter(bool wait) {
+        while (true) {
+            long ret = ::syscall(__NR_io_uring_enter, fd, unsubmitted, wait ? 1 : 0,
+                                 wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (ret >= 0) {
+                unsubmitted -= static_cast<unsigned>(ret);
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief 缓冲区index的写请求是否还在提交队列中，未被内核取走
+     */
+    bool isUnsubmitted(size_t index) const {
+        unsigned tail = *sqTail;
+        for (unsigned i = 1; i <= unsubmitted; ++i) {
+            if (sqes[(tail - i) & sqMask].user_data == index) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief 从offset开始写入全部数据，出错时放弃
+ */
+static void WriteAt(int fd, const char *data, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = ::pwrite(fd, data + done, len - done, offset + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+}
+
+UringFileLogAppender::UringFileLogAppender(const std::string &filename, int flushInterval, bool useUring)
+    : m_filename(filename), m_flushInterval(flushInterval), m_current(kNoBuffer) {
+    m_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd >= 0) {
+        //每个缓冲区按偏移写入，不能使用O_APPEND
+        off_t end = ::lseek(m_fd, 0, SEEK_END);
+        m_fileOffset = end > 0 ? static_cast<uint64_t>(end) : 0;
+    }
+
+    void *memory = nullptr;
+    if (::posix_memalign(&memory, 4096, kBufferCount * kBufferSize) == 0) {
+        m_memory = static_cast<char*>(memory);
+        for (size_t i = kBufferCount; i > 0; --i) {
+            m_free.push_back(i - 1);
+        }
+    }
+
+    if (useUring && setupUring()) {
+        m_threads.push_back(std::thread(&UringFileLogAppender::uringFunc, this));
+    }
+    else {
+        for (size_t i = 0; i < kFallbackThreads; ++i) {
+            m_threads.push_back(std::thread(&UringFileLogAppender::pwriteFunc, this));
+        }
+    }
+}
+
+UringFileLogAppender::~UringFileLogAppender() {
+    {
+        std::lock_guard<std::mutex> lock(m_bufferMutex);
+        seal();
+        m_running = false;
+    }
+    m_cond.notify_all();
+    for (auto &item : m_threads) {
+        item.join();
+    }
+    delete m_ring;
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    free(m_memory);
+}
+
+std::string UringFileLogAppender::toYamlString() {
+    return "";
+}
+
+void UringFileLogAppender::logFormatted(LogLevel::Level level, const char *data, size_t len) {
+    append(data, len);
+    if (level >= m_flushLevel.load(std::memory_order_relaxed)) {
+        if (m_staging.load(std::memory_order_relaxed)) {
+            LogStagingBuffer::GetThis()->flush();
+        }
+        //写入线程不等待内核完成写入
+        std::lock_guard<std::mutex> lock(m_bufferMutex);
+        seal();
+    }
+}
+
+void UringFileLogAppender::flush() {
+    if (m_staging.load(std::memory_order_relaxed)) {
+        LogStagingBuffer::GetThis()->flush();
+    }
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    seal();
+    m_idleCond.wait(lock, [this]() {return m_pending.empty() && m_inflight == 0;});
+}
+
+uint64_t UringFileLogAppender::getDropped() const {
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    return m_dropped;
+}
+
+void UringFileLogAppender::writeBuffer(const char *data, size_t len) {
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    if (!len) {
+        return;
+    }
+    if (len > available()) {
+        //空闲缓冲区放不下整条日志，不阻塞写入线程，整条丢弃
+        m_dropped += len;
+        m_droppedNotice += len;
+        return;
+    }
+    if (m_droppedNotice) {
+        //先写入丢弃提示
+        if (m_current != kNoBuffer && kBufferSize - m_currentLen < kDroppedNoticeSize) {
+            seal();
+        }
+        if (m_current == kNoBuffer) {
+            acquire();
+        }
+        m_currentLen += snprintf(bufferAt(m_current) + m_currentLen, kDroppedNoticeSize,
+                                 "Dropped log messages, %llu bytes\n",
+                                 static_cast<unsigned long long>(m_droppedNotice));
+        m_droppedNotice = 0;
+    }
+    while (len) {
+        if (m_current == kNoBuffer) {
+            acquire();
+        }
+        size_t n = std::min(len, kBufferSize - m_currentLen);
+        memcpy(bufferAt(m_current) + m_currentLen, data, n);
+        m_currentLen += n;
+        data += n;
+        len -= n;
+        if (m_currentLen == kBufferSize) {
+            seal();
+        }
+    }
+}
+
+size_t UringFileLogAppender::available() const {
+    if (m_fd < 0) {
+        return 0;
+    }
+    size_t size = m_free.size() * kBufferSize;
+    size_t rest = m_current != kNoBuffer ? kBufferSize - m_currentLen : 0;
+    if (m_droppedNotice) {
+        //先写入丢弃提示，当前缓冲区放不下时换下一个缓冲区
+        if (rest >= kDroppedNoticeSize) {
+            rest -= kDroppedNoticeSize;
+        }
+        else {
+            rest = 0;
+            size = size ? size - kDroppedNoticeSize : 0;
+        }
+    }
+    return size + rest;
+}
+
+bool UringFileLogAppender::acquire() {
+    if (m_free.empty() || m_fd < 0) {
+        return false;
+    }
+    m_current = m_free.back();
+    m_free.pop_back();
+    m_currentLen = 0;
+    return true;
+}
+
+void UringFileLogAppender::seal() {
+    if (m_current == kNoBuffer) {
+        return;
+    }
+    if (m_currentLen == 0) {
+        m_free.push_back(m_current);
+    }
+    else {
+        Pending pending = {m_current, m_currentLen, m_fileOffset};
+        m_pending.push_back(pending);
+        m_fileOffset += m_currentLen;
+        m_cond.notify_one();
+    }
+    m_current = kNoBuffer;
+    m_currentLen = 0;
+}
+
+void UringFileLogAppender::recycle(size_t index, bool reuse) {
+    if (reuse) {
+        m_free.push_back(index);
+    }
+    --m_inflight;
+    if (m_pending.empty() && m_inflight == 0) {
+        m_idleCond.notify_all();
+    }
+}
+
+bool UringFileLogAppender::setupUring() {
+    if (!m_memory || m_fd < 0) {
+        return false;
+    }
+    std::unique_ptr<Uring> ring(new Uring);
+    //短写时需要重新提交，队列长度留出余量
+    if (!ring->init(kBufferCount * 2)) {
+        return false;
+    }
+    iovec iov[kBufferCount];
+    for (size_t i = 0; i < kBufferCount; ++i) {
+        iov[i].iov_base = bufferAt(i);
+        iov[i].iov_len = kBufferSize;
+    }
+    //注册失败(如超过RLIMIT_MEMLOCK)时使用普通的IORING_OP_WRITE
+    ring->registerBuffers(iov, kBufferCount);
+    m_ring = ring.release();
+    return true;
+}
+
+void UringFileLogAppender::uringFunc() {
+    //每个缓冲区的写入进度，按缓冲区序号索引
+    Pending writes[kBufferCount];
+    size_t done[kBufferCount];
+    bool busy[kBufferCount] = {};
+    size_t inflight = 0;
+    bool failed = false;
+    std::vector<size_t> completed;
+
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    while (true) {
+        if (m_pending.empty() && inflight == 0) {
+            if (!m_running) {
+                break;
+            }
+            if (!m_cond.wait_for(lock, std::chrono::seconds(m_flushInterval),
+                                 [this]() {return !m_pending.empty() || !m_running;})) {
+                seal();
+            }
+            continue;
+        }
+        std::deque<Pending> batch;
+        batch.swap(m_pending);
+        m_inflight += batch.size();
+        lock.unlock();
+
+        for (auto &item : batch) {
+            writes[item.index] = item;
+            done[item.index] = 0;
+            busy[item.index] = true;
+            m_ring->prepareWrite(m_fd, bufferAt(item.index), item.len, item.offset, item.index);
+        }
+        inflight += batch.size();
+        //没有新的请求时等待完成
+        if (!m_ring->enter(batch.empty())) {
+            failed = true;
+            break;
+        }
+
+        unsigned head = *m_ring->cqHead;
+        unsigned tail = __atomic_load_n(m_ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = m_ring->cqes[head & m_ring->cqMask];
+            size_t index = static_cast<size_t>(cqe.user_data);
+            const Pending &item = writes[index];
+            if (cqe.res > 0) {
+                done[index] += cqe.res;
+            }
+            bool retry = cqe.res == -EINTR || cqe.res == -EAGAIN;
+            if ((cqe.res > 0 || retry) && done[index] < item.len) {
+                //短写，提交剩余部分
+                m_ring->prepareWrite(m_fd, bufferAt(index) + done[index], item.len - done[index],
+                                     item.offset + done[index], index);
+                continue;
+            }
+            //写完或出错，出错的缓冲区丢弃
+            busy[index] = false;
+            completed.push_back(index);
+        }
+        __atomic_store_n(m_ring->cqHead, head, __ATOMIC_RELEASE);
+        bool ok = !m_ring->unsubmitted || m_ring->enter(false);
+
+        lock.lock();
+        for (auto index : completed) {
+            recycle(index);
+        }
+        inflight -= completed.size();
+        completed.clear();
+        if (!ok) {
+            failed = true;
+            lock.unlock();
+            break;
+        }
+    }
+    if (!failed) {
+        return;
+    }
+
+    //io_uring_enter出现不可重试的错误，未完成的缓冲区改用pwrite写入，之后转为pwrite线程。
+    //内核已取走的请求可能稍后才执行，对应的缓冲区写入后不再复用，以免覆盖之后的内容
+    for (size_t index = 0; index < kBufferCount; ++index) {
+        if (busy[index]) {
+            const Pending &item = writes[index];
+            WriteAt(m_fd, bufferAt(index) + done[index], item.len - done[index], item.offset + done[index]);
+        }
+    }
+    lock.lock();
+    for (size_t index = 0; index < kBufferCount; ++index) {
+        if (busy[index]) {
+            recycle(index, m_ring->isUnsubmitted(index));
+        }
+    }
+    lock.unlock();
+    pwriteFunc();
+}
+
+void UringFileLogAppender::pwriteFunc() {
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    while (true) {
+        if (m_pending.empty()) {
+            if (!m_running) {
+                break;
+            }
+            if (!m_cond.wait_for(lock, std::chrono::seconds(m_flushInterval),
+                                 [this]() {return !m_pending.empty() || !m_running;})) {
+                seal();
+            }
+            continue;
+        }
+        Pending item = m_pending.front();
+        m_pending.pop_front();
+        ++m_inflight;
+        lock.unlock();
+
+        WriteAt(m_fd, bufferAt(item.index), item.len, item.offset);
+
+        lock.lock();
+        recycle(item.index);
+    }
+}
+
+KAFKA_NAMESPACE_END
@@ -0,0 +1,152 @@
+/**
+ * @file uringFileLogAppender.h
+ * @brief 基于io_uring的异步文件输出
+ * @author ziv
+ * @email
+ * @date 22-11-16.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_URINGFILELOGAPPENDER_H
+#define KAFKA_URINGFILELOGAPPENDER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "log.h"
+#include "../basic/basicDefine.h"
+
+KAFKA_NAMESPACE_BEGIN
+
+/**
+ * @brief 基于io_uring的异步文件输出
+ * @details 日志写入固定数量的缓冲区，写满或超时后交给后台，写入线程只做内存拷贝。
+ *          缓冲区在启动时注册到io_uring，后台线程以IORING_OP_WRITE_FIXED批量提交，
+ *          完成后缓冲区回到空闲列表供写入线程复用。io_uring不可用时改为线程池pwrite。
+ *          每个缓冲区在交出时就确定了文件偏移，多个写入可以同时进行；空闲缓冲区放不下整条日志时丢弃该日志并记录丢弃的字节数。
+ *          io_uring_enter出现不可重试的错误时后台线程改为pwrite
+ */
+class UringFileLogAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<UringFileLogAppender> UringFileLogAppenderPtr;
+
+    //缓冲区数量
+    static const size_t kBufferCount = 8;
+    //缓冲区大小
+    static const size_t kBufferSize = 1024 * 1024;
+    //io_uring不可用时pwrite线程数
+    static const size_t kFallbackThreads = 2;
+
+    /**
+     * @brief
+     * @param filename 文件名，已存在时追加
+     * @param flushInterval 缓冲区未写满时最长等待秒数
+     * @param useUring 是否尝试使用io_uring，为false时直接使用pwrite线程池
+     */
+    explicit UringFileLogAppender(const std::string &filename, int flushInterval = 3, bool useUring = true);
+
+    ~UringFileLogAppender() override;
+
+    std::string toYamlString() override;
+
+    /**
+     * @brief 是否使用io_uring
+     */
+    bool isUring() const {return m_ring != nullptr;}
+
+    /**
+     * @brief 写入日志，达到刷新级别时只把当前缓冲区交给后台，不等待写入完成
+     */
+    void logFormatted(LogLevel::Level level, const char *data, size_t len) override;
+
+    /**
+     * @brief 将当前缓冲区交给后台，并等待所有已提交的写入完成
+     */
+    void flush() override;
+
+    /**
+     * @brief 因没有空闲缓冲区丢弃的字节数
+     */
+    uint64_t getDropped() const;
+
+protected:
+    void writeBuffer(const char *data, size_t len) override;
+
+private:
+    struct Uring;
+
+    /**
+     * @brief 待写入的缓冲区
+     */
+    struct Pending {
+        size_t index;
+        size_t len;
+        uint64_t offset;
+    };
+
+    /**
+     * @brief 将当前缓冲区交给后台，需持有m_bufferMutex
+     */
+    void seal();
+
+    /**
+     * @brief 当前缓冲区和空闲缓冲区还能写入的字节数，需持有m_bufferMutex
+     */
+    size_t available() const;
+
+    /**
+     * @brief 获取一个空闲缓冲区作为当前缓冲区，需持有m_bufferMutex
+     * @return 是否有空闲缓冲区
+     */
+    bool acquire();
+
+    /**
+     * @brief 写入完成，需持有m_bufferMutex
+     * @param reuse 是否放回空闲列表
+     */
+    void recycle(size_t index, bool reuse = true);
+
+    char* bufferAt(size_t index) const {return m_memory + index * kBufferSize;}
+
+    bool setupUring();
+
+    void uringFunc();
+
+    void pwriteFunc();
+
+private:
+    std::string m_filename;
+    int m_fd = -1;
+    int m_flushInterval;
+    char *m_memory = nullptr;
+    Uring *m_ring = nullptr;
+
+    mutable std::mutex m_bufferMutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_idleCond;
+    //当前写入的缓冲区，没有空闲缓冲区时为kNoBuffer
+    size_t m_current;
+    size_t m_currentLen = 0;
+    std::vector<size_t> m_free;
+    std::deque<Pending> m_pending;
+    //后台正在写入的缓冲区数
+    size_t m_inflight = 0;
+    //下一个缓冲区的文件偏移
+    uint64_t m_fileOffset = 0;
+    uint64_t m_dropped = 0;
+    //尚未写入的丢弃字节数，下一条日志之前先写入提示
+    uint64_t m_droppedNotice = 0;
+    bool m_running = true;
+    std::vector<std::thread> m_threads;
+
+    static const size_t kNoBuffer = ~static_cast<size_t>(0);
+    //丢弃提示的最大长度
+    static const size_t kDroppedNoticeSize = 64;
+};
+
+KAFKA_NAMESPACE_END
+
+#endif //KAFKA_URINGFILELOGAPPENDER_H
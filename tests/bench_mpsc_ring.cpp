@@ -0,0 +1,132 @@
+/**
+ * @file bench_mpsc_ring.cpp
+ * @brief MpscRing 以及 AsyncLogDispatcher 在不同生产者线程数下的吞吐
+ * @author ziv
+ * @email
+ * @date 22-11-4.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include "../src/log/logInclude.h"
+#include "../src/log/mpscRing.h"
+#include "../src/log/logDispatcher.h"
+
+class NullLogAppender : public KAFKA::LogAppender {
+public:
+    void logFormatted(KAFKA::LogLevel::Level level, const char *data, size_t len) override {
+        ++m_count;
+    }
+
+    std::string toYamlString() override {return "";}
+
+protected:
+    void writeBuffer(const char *data, size_t len) override {}
+
+public:
+
+    std::atomic<uint64_t> m_count{0};
+};
+
+static double seconds(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static double benchRing(int producers, uint64_t total) {
+    KAFKA::MpscRing<uint64_t> ring(65536);
+    uint64_t perThread = total / producers;
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([&]() {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            for (uint64_t n = 0; n < perThread; ++n) {
+                uint64_t v = n;
+                while (!ring.tryPush(std::move(v))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    go = true;
+    uint64_t expect = perThread * producers;
+    uint64_t value;
+    for (uint64_t got = 0; got < expect;) {
+        if (ring.tryPop(value)) {
+            ++got;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    double cost = seconds(begin);
+    for (auto &t : threads) {
+        t.join();
+    }
+    return expect / cost;
+}
+
+static double benchLogger(int producers, uint64_t total) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("bench"));
+    std::shared_ptr<NullLogAppender> appender(new NullLogAppender);
+    logger->addAppender(appender);
+    logger->setDispatcher(KAFKA::AsyncLogDispatcher::AsyncLogDispatcherPtr(new KAFKA::AsyncLogDispatcher));
+
+    uint64_t perThread = total / producers;
+    uint64_t expect = perThread * producers;
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([&]() {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            for (uint64_t n = 0; n < perThread; ++n) {
+                KAFKA_LOG_INFO(logger) << "bench message " << n;
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    go = true;
+    for (auto &t : threads) {
+        t.join();
+    }
+    //stop输出队列中剩余的全部事件后返回，输出有遗漏时报错而不是一直等待
+    logger->getDispatcher()->stop();
+    double cost = seconds(begin);
+    if (appender->m_count != expect) {
+        fprintf(stderr, "logger delivered %llu of %llu events\n",
+                (unsigned long long)appender->m_count.load(), (unsigned long long)expect);
+        return -1;
+    }
+    return expect / cost;
+}
+
+int main(int argc, char **argv) {
+    uint64_t ringTotal = 1 << 22;
+    uint64_t logTotal = 1 << 18;
+    if (argc > 1) {
+        ringTotal = strtoull(argv[1], nullptr, 10);
+        logTotal = ringTotal / 16;
+    }
+
+    printf("%-10s %18s %18s\n", "producers", "ring ops/s", "logger events/s");
+    for (int producers = 1; producers <= 64; producers <<= 1) {
+        double ring = benchRing(producers, ringTotal);
+        double log = benchLogger(producers, logTotal);
+        if (log < 0) {
+            return 1;
+        }
+        printf("%-10d %18.0f %18.0f\n", producers, ring, log);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file test_async_writer.cpp
+ * @brief 异步写入器停止后文件内容完整、有序，超过一块缓冲区的记录不丢失
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include "test_helper.h"
+#include "../src/log/asyncLogWriter.h"
+
+int main(int argc, char **argv) {
+    char path[] = "/tmp/kafka_async_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return 1;
+    }
+    close(fd);
+
+    std::string expect;
+    {
+        //写入间隔足够长，停止时只能靠通知唤醒后台线程
+        KAFKA::AsyncLogWriter writer(path, 30);
+        writer.start();
+        char line[64];
+        for (int i = 0; i < 1000; ++i) {
+            int n = snprintf(line, sizeof(line), "before %d\n", i);
+            writer.append(line, n);
+            expect.append(line, n);
+        }
+        std::string large(KAFKA::kLargeBuffer * 2 + 12345, 'x');
+        large.back() = '\n';
+        writer.append(large.data(), large.size());
+        expect.append(large);
+        for (int i = 0; i < 1000; ++i) {
+            int n = snprintf(line, sizeof(line), "after %d\n", i);
+            writer.append(line, n);
+            expect.append(line, n);
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        writer.stop();
+        auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        if (!check(cost.count() < 5000, "stop wakes the writer thread")) {
+            return 1;
+        }
+    }
+
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    unlink(path);
+    if (!check(ss.str().size() == expect.size(), "file size")
+        || !check(ss.str() == expect, "file content in order")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file test_binary_log.cpp
+ * @brief 二进制日志经kafka-logdecode还原后与直接格式化输出的文本一致，限流跳过的数量也写入二进制日志
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include "test_helper.h"
+
+static const char *kPattern = "%t %N %F [%p] %f:%l %m%n";
+
+/**
+ * @brief 同一组调用点分别写入二进制日志和文本输出，调用点相同时文件名和行号也相同
+ */
+static void logAll(const KAFKA::Logger::LoggerPtr &logger) {
+    const char *null = nullptr;
+    std::string str = "std string";
+    KAFKA_LOG_FMT_INFO(logger, "int %d %i %+d %5d|%-5d|%05d", 42, -7, 3, 12, 34, -56);
+    KAFKA_LOG_FMT_INFO(logger, "unsigned %u %x %X %#x %o %#o", 42u, 255u, 255u, 255u, 8u, 8u);
+    KAFKA_LOG_FMT_INFO(logger, "short %hd %hu %hx %hhd %hhu %hhx", 70000, 70000, -1, 300, 300, -1);
+    KAFKA_LOG_FMT_WARN(logger, "long %ld %lu %lld %llu %zu %lx", -1L, 1UL << 40, INT64_MIN, UINT64_MAX,
+                       sizeof(int), 0xdeadbeefUL);
+    KAFKA_LOG_FMT_ERROR(logger, "float %f %.2f %10.3f|%-10.1e|%g %Lf", 1.5, 3.14159, -2.5, 12345.678, 0.0001, 1.5L);
+    KAFKA_LOG_FMT_INFO(logger, "star %*d|%-*d|%.*f", 6, 42, 4, 7, 3, 2.71828);
+    KAFKA_LOG_FMT_INFO(logger, "string %s|%10s|%-6s|%.3s|%s|%s", "cstr", "right", "left", "truncate", null,
+                       str.c_str());
+    KAFKA_LOG_FMT_INFO(logger, "char %c%c%c percent 100%% pointer %p %p", 'a', 'b', 'c',
+                       reinterpret_cast<void*>(0x1234abcd), static_cast<void*>(nullptr));
+}
+
+/**
+ * @brief 用kafka-logdecode解码，kafka-logdecode与测试程序在同一目录
+ * @return kafka-logdecode的退出状态
+ */
+static int decode(const std::string &self, const char *path, std::string &got) {
+    std::string command = self.substr(0, self.rfind('/') + 1) + "kafka-logdecode -p '" + kPattern + "' " + path;
+    FILE *pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        printf("FAILED: popen %s\n", command.c_str());
+        return -1;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+        got.append(buf, n);
+    }
+    return pclose(pipe);
+}
+
+/**
+ * @brief 限流跳过的数量在下一条通过的记录之前写入二进制日志
+ */
+static bool checkSuppressed(const std::string &self) {
+    char path[] = "/tmp/kafka_binary_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return false;
+    }
+    close(fd);
+
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("binary"));
+    logger->setBinaryLogFile(path);
+    for (int i = 0; i < 7; ++i) {
+        KAFKA_LOG_FMT_EVERY_N(logger, KAFKA::LogLevel::INFO, 3, "every %d", i);
+    }
+    logger->setBinaryLogFile("");
+
+    std::string got;
+    int status = decode(self, path, got);
+    unlink(path);
+    std::string expect;
+    const char *lines[] = {"every 0", "suppressed 2 records since last output", "every 3",
+                           "suppressed 2 records since last output", "every 6"};
+    for (auto line : lines) {
+        expect.append(line).append("\n");
+    }
+    //只比较每行的正文
+    std::string text;
+    size_t pos = 0;
+    while (pos < got.size()) {
+        size_t end = got.find('\n', pos);
+        if (end == std::string::npos) {
+            end = got.size();
+        }
+        size_t begin = got.find(' ', got.find(':', got.find('[', pos)));
+        text.append(got, begin + 1, end - begin - 1).append("\n");
+        pos = end + 1;
+    }
+    if (status != 0 || text != expect) {
+        printf("FAILED: suppressed summary\nexpect:\n%sgot:\n%s", expect.c_str(), got.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    char path[] = "/tmp/kafka_binary_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return 1;
+    }
+    close(fd);
+
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("binary"));
+    LineAppender::LineAppenderPtr appender(new LineAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter(kPattern)));
+    logger->addAppender(appender);
+
+    //写入器释放时把剩余的记录写入文件
+    logger->setBinaryLogFile(path);
+    logAll(logger);
+    logger->setBinaryLogFile("");
+    logAll(logger);
+    std::string expect;
+    for (auto &line : appender->lines) {
+        expect.append(line);
+    }
+
+    std::string got;
+    int status = decode(argv[0], path, got);
+    unlink(path);
+
+    if (!check(status == 0, "kafka-logdecode exit status")) {
+        return 1;
+    }
+    if (got != expect) {
+        printf("FAILED: decoded text differs\nexpect:\n%sgot:\n%s", expect.c_str(), got.c_str());
+        return 1;
+    }
+    if (!checkSuppressed(argv[0])) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file test_date_time_format.cpp
+ * @brief 时间格式化: 亚秒字段按位数写入缓存结果，同一秒复用缓存，秒数和格式变化时重新渲染
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include "test_helper.h"
+
+static std::string render(const KAFKA::DateTimeFormat &format, uint64_t sec, uint32_t nsec) {
+    KAFKA::LogBuffer buf;
+    format.format(buf, sec, nsec);
+    return buf.toString();
+}
+
+static std::string local(const char *format, uint64_t sec) {
+    struct tm tm;
+    time_t time = static_cast<time_t>(sec);
+    localtime_r(&time, &tm);
+    char buf[256];
+    return std::string(buf, strftime(buf, sizeof(buf), format, &tm));
+}
+
+static bool expect(const KAFKA::DateTimeFormat &format, uint64_t sec, uint32_t nsec, const std::string &value) {
+    std::string got = render(format, sec, nsec);
+    if (got != value) {
+        printf("FAILED: format '%s' expect '%s' got '%s'\n", format.getFormat().c_str(), value.c_str(), got.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const uint64_t sec = 1668000040;
+    const std::string S = local("%S", sec);
+
+    //相邻的亚秒字段各自独立
+    KAFKA::DateTimeFormat adjacent("%S.%3N|%3N%3N");
+    KAFKA::DateTimeFormat widths("%N %9N %6N %3N");
+    KAFKA::DateTimeFormat literal("%%%3N%%N %Y");
+    if (!expect(adjacent, sec, 123456789, S + ".123|123123")
+        || !expect(widths, sec, 123456789, "123456789 123456789 123456 123")
+        || !expect(widths, sec, 5, "000000005 000000005 000000 000")
+        || !expect(literal, sec, 987000000, "%987%N " + local("%Y", sec))) {
+        return 1;
+    }
+
+    //同一秒内复用缓存，只替换亚秒数字
+    KAFKA::DateTimeFormat full("%Y-%m-%d %H:%M:%S.%6N");
+    for (uint32_t nsec = 0; nsec < 1000000000; nsec += 99999937) {
+        char tail[16];
+        snprintf(tail, sizeof(tail), ".%06u", nsec / 1000);
+        if (!expect(full, sec, nsec, local("%Y-%m-%d %H:%M:%S", sec) + tail)) {
+            return 1;
+        }
+    }
+    //秒数变化时重新渲染
+    for (uint64_t s = sec; s < sec + 3; ++s) {
+        if (!expect(full, s, 1000, local("%Y-%m-%d %H:%M:%S", s) + ".000001")) {
+            return 1;
+        }
+    }
+
+    //超过缓存槽数的格式交替使用，互相替换缓存后结果仍正确
+    std::vector<std::unique_ptr<KAFKA::DateTimeFormat>> formats;
+    for (int i = 0; i < 20; ++i) {
+        formats.emplace_back(new KAFKA::DateTimeFormat("%H:%M:%S " + std::to_string(i) + " %3N"));
+    }
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 20; ++i) {
+            uint64_t s = sec + (i + round) % 2;
+            if (!expect(*formats[i], s, 42000000, local("%H:%M:%S ", s) + std::to_string(i) + " 042")) {
+                return 1;
+            }
+        }
+    }
+
+    //默认格式
+    if (!expect(KAFKA::DateTimeFormat(), sec, 0, local("%Y-%m-%d %H:%M:%S", sec))) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
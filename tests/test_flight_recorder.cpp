@@ -0,0 +1,144 @@
+/**
+ * @file test_flight_recorder.cpp
+ * @brief 崩溃时写出最近的日志记录
+ * @author ziv
+ * @email
+ * @date 22-11-20.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include "test_helper.h"
+
+static void crash(const char *filename) {
+    KAFKA::LogFlightRecorder::Enable(filename);
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("crash"));
+    logger->setLevel(KAFKA::LogLevel::ERROR);
+    //级别被过滤的格式化日志也进入环，只保留最后kSlots条
+    for (int i = 0; i < 1000; ++i) {
+        std::string item = "item-" + std::to_string(i);
+        KAFKA_LOG_FMT_DEBUG(logger, "%s at %d", item.c_str(), i);
+    }
+    //级别被过滤的流式日志保留正文
+    KAFKA_LOG_DEBUG(logger) << "filtered stream " << 42;
+    KAFKA_LOG_ERROR(logger) << "about to crash";
+    abort();
+}
+
+/**
+ * @brief 写入线程不断覆盖环的同时导出，导出的每条记录都是完整的
+ * @details 每条记录的两个参数满足b == a * 3，读到正在覆盖的记录时两者来自不同的记录
+ */
+static bool dumpWhileWriting(const std::string &decoder, const std::string &filename) {
+    KAFKA::LogFlightRecorder::Enable(filename);
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("overwrite"));
+    logger->setLevel(KAFKA::LogLevel::ERROR);
+    std::atomic<bool> running(true);
+    std::thread writer([&]() {
+        for (int i = 0; running; ++i) {
+            KAFKA_LOG_FMT_DEBUG(logger, "pair %d %d", i, i * 3);
+        }
+    });
+    bool ok = true;
+    size_t records = 0;
+    for (int round = 0; round < 50 && ok; ++round) {
+        if (!check(KAFKA::LogFlightRecorder::Dump(filename.c_str()), "dump while writing")) {
+            ok = false;
+            break;
+        }
+        std::string command = decoder + " -p '%m%n' " + filename;
+        FILE *pipe = popen(command.c_str(), "r");
+        char line[256];
+        while (pipe && fgets(line, sizeof(line), pipe)) {
+            int a, b;
+            if (sscanf(line, "pair %d %d", &a, &b) == 2) {
+                ++records;
+                if (b != a * 3) {
+                    printf("FAILED: torn record '%s'\n", line);
+                    ok = false;
+                }
+            }
+        }
+        if (!pipe || pclose(pipe) != 0) {
+            printf("FAILED: %s\n", command.c_str());
+            ok = false;
+        }
+    }
+    running = false;
+    writer.join();
+    KAFKA::LogFlightRecorder::Disable();
+    unlink(filename.c_str());
+    return ok && check(records > 0, "records dumped while writing");
+}
+
+/**
+ * @brief 级别被过滤的调用不求值限流条件
+ */
+static bool filteredCond(const std::string &filename) {
+    KAFKA::LogFlightRecorder::Enable(filename);
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("cond"));
+    logger->setLevel(KAFKA::LogLevel::ERROR);
+    int conds = 0;
+    for (int i = 0; i < 10; ++i) {
+        KAFKA_LOG_FMT_LEVEL_IF(logger, KAFKA::LogLevel::DEBUG, ++conds > 0, "cond %d", i);
+        KAFKA_LOG_LEVEL_IF(logger, KAFKA::LogLevel::DEBUG, ++conds > 0) << "cond " << i;
+    }
+    KAFKA::LogFlightRecorder::Disable();
+    return check(conds == 0, "cond skipped for filtered calls");
+}
+
+int main(int argc, char **argv) {
+    std::string filename = "/tmp/kafka_test_flight_recorder." + std::to_string(getpid());
+    pid_t pid = fork();
+    if (pid == 0) {
+        crash(filename.c_str());
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!check(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT, "child aborted")) {
+        return 1;
+    }
+
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string content = ss.str();
+    unlink(filename.c_str());
+    if (!check(content.compare(0, 8, KAFKA::BinaryLog::Magic()) == 0, "file header")) {
+        return 1;
+    }
+    if (!check(content.find("item-999") != std::string::npos && content.find("item-0") == std::string::npos
+               && content.find("%s at %d") != std::string::npos, "filtered records")) {
+        return 1;
+    }
+    if (!check(content.find("about to crash") != std::string::npos
+               && content.find("filtered stream 42") != std::string::npos, "stream record")) {
+        return 1;
+    }
+    if (!check(content.find("crash") != std::string::npos && content.find("abort") != std::string::npos,
+               "backtrace")) {
+        return 1;
+    }
+
+    //kafka-logdecode与测试程序在同一目录
+    std::string self = argv[0];
+    if (!dumpWhileWriting(self.substr(0, self.rfind('/') + 1) + "kafka-logdecode", filename)) {
+        return 1;
+    }
+
+    if (!filteredCond(filename)) {
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file test_helper.h
+ * @brief 测试共用的检查函数和输出目标
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#ifndef KAFKA_TEST_HELPER_H
+#define KAFKA_TEST_HELPER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "../src/log/logInclude.h"
+
+/**
+ * @brief 条件不满足时输出失败信息
+ */
+static inline bool check(bool v, const char *what) {
+    if (!v) {
+        printf("FAILED: %s\n", what);
+    }
+    return v;
+}
+
+/**
+ * @brief 记录收到的日志，每次写入保存为一项
+ */
+class LineAppender : public KAFKA::LogAppender {
+public:
+    typedef std::shared_ptr<LineAppender> LineAppenderPtr;
+
+    std::string toYamlString() override {return "";}
+
+    std::vector<std::string> lines;
+
+protected:
+    void writeBuffer(const char *data, size_t len) override {
+        lines.push_back(std::string(data, len));
+    }
+};
+
+/**
+ * @brief 统计收到的日志行
+ */
+class CountAppender : public KAFKA::LogAppender {
+public:
+    typedef std::shared_ptr<CountAppender> CountAppenderPtr;
+
+    std::string toYamlString() override {return "";}
+
+    int count = 0;
+
+protected:
+    void writeBuffer(const char *data, size_t len) override {
+        for (size_t i = 0; i < len; ++i) {
+            count += data[i] == '\n';
+        }
+    }
+};
+
+#endif //KAFKA_TEST_HELPER_H
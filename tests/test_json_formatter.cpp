@@ -0,0 +1,59 @@
+/**
+ * @file test_json_formatter.cpp
+ * @brief JSON格式器与键值字段
+ * @author ziv
+ * @email
+ * @date 22-11-19.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "test_helper.h"
+
+static std::string escape(const std::string &s) {
+    KAFKA::LogBuffer buf;
+    KAFKA::JsonLogFormatter::Escape(buf, s.data(), s.size());
+    return std::string(buf.data(), buf.size());
+}
+
+int main(int argc, char **argv) {
+    //需要转义的字符落在16/32字节块的不同位置
+    std::string plain(70, 'a');
+    for (size_t pos : {0, 15, 16, 31, 32, 47, 69}) {
+        std::string s = plain;
+        s[pos] = '"';
+        std::string expect = plain.substr(0, pos) + "\\\"" + plain.substr(pos + 1);
+        if (!check(escape(s) == expect, "escape position")) {
+            return 1;
+        }
+    }
+    if (!check(escape(std::string("a\\b\n\t\x01\x7f", 7)) == "a\\\\b\\n\\t\\u0001\x7f", "escape chars")) {
+        return 1;
+    }
+
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("json"));
+    std::shared_ptr<LineAppender> text(new LineAppender);
+    text->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m%n")));
+    std::shared_ptr<LineAppender> json(new LineAppender);
+    json->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::JsonLogFormatter));
+    logger->addAppender(text);
+    logger->addAppender(json);
+
+    KAFKA_LOG_INFO(logger) << "say \"hi\"" << KAFKA::LogField("user", 42) << KAFKA::LogField("ok", true)
+                           << KAFKA::LogField("ratio", 0.5) << KAFKA::LogField("name", "a\"b");
+    if (!check(text->lines.size() == 1 && text->lines[0] == "say \"hi\" user=42 ok=true ratio=0.5 name=a\"b\n",
+               "text fields")) {
+        return 1;
+    }
+    const std::string &line = json->lines.empty() ? std::string() : json->lines[0];
+    if (!check(line.find("\"logger\":\"json\"") != std::string::npos
+               && line.find("\"message\":\"say \\\"hi\\\"\",\"user\":42,\"ok\":true,\"ratio\":0.5,\"name\":\"a\\\"b\"}\n")
+                  != std::string::npos, "json fields")) {
+        printf("%s", line.c_str());
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file test_log_alloc.cpp
+ * @brief 稳定状态下写日志不申请堆内存
+ * @author ziv
+ * @email
+ * @date 22-11-9.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include <thread>
+#include "../src/log/logInclude.h"
+#include "../src/log/logDispatcher.h"
+
+//替换malloc统计当前线程的堆内存申请次数，operator new和LogBuffer都经过malloc。
+//只统计当前线程，LoggerManager定时线程等其他线程的申请不计入
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void *p, size_t size);
+}
+
+static thread_local uint64_t t_allocs = 0;
+
+extern "C" void* malloc(size_t size) {
+    ++t_allocs;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    ++t_allocs;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void *p, size_t size) {
+    ++t_allocs;
+    return __libc_realloc(p, size);
+}
+
+void* operator new(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+/**
+ * @brief 只统计输出的条数，供生产者等待消费线程输出完一批日志
+ */
+class DrainAppender : public KAFKA::LogAppender {
+public:
+    void logFormatted(KAFKA::LogLevel::Level level, const char *data, size_t len) override {
+        count.fetch_add(1, std::memory_order_release);
+    }
+
+    std::string toYamlString() override {return "";}
+
+    std::atomic<uint64_t> count{0};
+
+protected:
+    void writeBuffer(const char *data, size_t len) override {}
+};
+
+static void logOnce(KAFKA::Logger::LoggerPtr logger, int i) {
+    KAFKA_LOG_INFO(logger) << "steady state message number " << i << " with a payload longer than sso";
+    KAFKA_LOG_FMT_WARN(logger, "formatted message %d, %s", i, "with another string argument");
+}
+
+int main(int argc, char **argv) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("alloc"));
+    logger->addAppender(KAFKA::LogAppender::LogAppenderPtr(new KAFKA::FileLogAppender("/dev/null")));
+
+    for (int i = 0; i < 1000; ++i) {
+        logOnce(logger, i);
+    }
+
+    uint64_t before = t_allocs;
+    const int count = 10000;
+    for (int i = 0; i < count; ++i) {
+        logOnce(logger, i);
+    }
+    uint64_t allocs = t_allocs - before;
+
+    printf("%d log calls, %lu heap allocations\n", count * 2, static_cast<unsigned long>(allocs));
+    if (allocs != 0) {
+        printf("FAILED: steady-state logging allocated memory\n");
+        return 1;
+    }
+
+    //事件由分发器的消费线程释放，生产者仍然复用
+    KAFKA::Logger::LoggerPtr async(new KAFKA::Logger("alloc_async"));
+    std::shared_ptr<DrainAppender> appender(new DrainAppender);
+    async->addAppender(appender);
+    async->setDispatcher(KAFKA::AsyncLogDispatcher::AsyncLogDispatcherPtr(new KAFKA::AsyncLogDispatcher(1024)));
+    const int burst = 100;
+    uint64_t expect = 0;
+    auto logBurst = [&]() {
+        for (int i = 0; i < burst; ++i) {
+            logOnce(async, i);
+        }
+        expect += burst * 2;
+        while (appender->count.load(std::memory_order_acquire) < expect) {
+            std::this_thread::yield();
+        }
+    };
+    for (int i = 0; i < 200; ++i) {
+        logBurst();
+    }
+    before = t_allocs;
+    for (int i = 0; i < count / burst; ++i) {
+        logBurst();
+    }
+    allocs = t_allocs - before;
+    async->getDispatcher()->stop();
+
+    printf("%d dispatched log calls, %lu heap allocations\n", count * 2, static_cast<unsigned long>(allocs));
+    if (allocs != 0) {
+        printf("FAILED: steady-state dispatched logging allocated memory\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
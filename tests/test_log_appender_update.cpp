@@ -0,0 +1,101 @@
+/**
+ * @file test_log_appender_update.cpp
+ * @brief 写日志的同时增删输出目标，已有的输出目标不丢日志，增删的输出目标只收到完整的日志，删除后被释放
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "test_helper.h"
+
+int main(int argc, char **argv) {
+    const int threads = 4;
+    const int count = 20000;
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("update"));
+    KAFKA::LogFormatter::LogFormatterPtr formatter(new KAFKA::LogFormatter("%m%n"));
+    CountAppender::CountAppenderPtr fixed(new CountAppender);
+    fixed->setFormatter(formatter);
+    logger->addAppender(fixed);
+
+    std::atomic<bool> running(true);
+    std::vector<LineAppender::LineAppenderPtr> added;
+    std::thread updater([&]() {
+        //每次新增一个输出目标，并删除上一个
+        LineAppender::LineAppenderPtr last;
+        while (running) {
+            LineAppender::LineAppenderPtr appender(new LineAppender);
+            appender->setFormatter(formatter);
+            logger->addAppender(appender);
+            if (last) {
+                logger->delAppender(last);
+            }
+            added.push_back(appender);
+            last = appender;
+        }
+        logger->delAppender(last);
+    });
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < count; ++i) {
+                KAFKA_LOG_FMT_INFO(logger, "t%d n%d", t, i);
+            }
+        });
+    }
+    for (auto &item : workers) {
+        item.join();
+    }
+    running = false;
+    updater.join();
+
+    if (!check(fixed->count == threads * count, "fixed appender got every record")
+        || !check(added.size() > 1, "appenders were updated while logging")) {
+        return 1;
+    }
+    for (auto &appender : added) {
+        for (auto &line : appender->lines) {
+            int t, n;
+            char end;
+            if (sscanf(line.c_str(), "t%d n%d%c", &t, &n, &end) != 3 || end != '\n' || t < 0 || t >= threads) {
+                printf("FAILED: corrupted line '%s'\n", line.c_str());
+                return 1;
+            }
+        }
+    }
+    //删除后不再收到日志
+    KAFKA_LOG_INFO(logger) << "after";
+    size_t total = 0;
+    for (auto &appender : added) {
+        total += appender->lines.size();
+        if (!appender->lines.empty() && appender->lines.back() == "after\n") {
+            printf("FAILED: removed appender got a record\n");
+            return 1;
+        }
+    }
+    if (!check(fixed->count == threads * count + 1, "fixed appender after update")) {
+        return 1;
+    }
+    //删除后没有其他引用的输出目标被释放
+    std::vector<std::weak_ptr<LineAppender>> weak(added.begin(), added.end());
+    added.clear();
+    for (auto &item : weak) {
+        if (!item.expired()) {
+            printf("FAILED: removed appender was not destroyed\n");
+            return 1;
+        }
+    }
+    std::weak_ptr<CountAppender> weakFixed = fixed;
+    logger->delAppender(fixed);
+    fixed.reset();
+    if (!check(weakFixed.expired(), "fixed appender destroyed after delAppender")) {
+        return 1;
+    }
+    printf("OK (%zu appenders, %zu records)\n", weak.size(), total);
+    return 0;
+}
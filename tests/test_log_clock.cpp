@@ -0,0 +1,59 @@
+/**
+ * @file test_log_clock.cpp
+ * @brief 日志时钟
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "test_helper.h"
+
+static uint64_t readClock(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    //校准前后都单调递增
+    uint64_t last = KAFKA::LogClock::Now();
+    for (int i = 0; i < 100000; ++i) {
+        if (i % 10000 == 0) {
+            usleep(1000);
+            KAFKA::LogClock::Recalibrate(0);
+        }
+        uint64_t now = KAFKA::LogClock::Now();
+        if (!check(now >= last, "monotonic")) {
+            return 1;
+        }
+        last = now;
+    }
+
+    //与系统时钟的差值，COARSE时钟的精度为几毫秒
+    uint64_t monotonic = readClock(CLOCK_MONOTONIC);
+    uint64_t now = KAFKA::LogClock::Now();
+    usleep(200 * 1000);
+    uint64_t elapsed = KAFKA::LogClock::Now() - now;
+    uint64_t expect = readClock(CLOCK_MONOTONIC) - monotonic;
+    if (!check(llabs(static_cast<long long>(elapsed - expect)) < 10 * 1000000, "rate")) {
+        return 1;
+    }
+    int64_t wall = static_cast<int64_t>(KAFKA::LogClock::ToWallTime(KAFKA::LogClock::Now()));
+    if (!check(llabs(wall - static_cast<int64_t>(readClock(CLOCK_REALTIME))) < 10 * 1000000, "wall time")) {
+        return 1;
+    }
+
+    //事件只保存时间戳，格式化时换算
+    KAFKA::LogEvent event(nullptr, KAFKA::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, now, "main");
+    if (!check(event.getTimestamp() == now && event.getWallTime() == KAFKA::LogClock::ToWallTime(now)
+               && event.getTime() == event.getWallTime() / 1000000000, "event time")) {
+        return 1;
+    }
+
+    printf("%s OK\n", KAFKA::LogClock::IsTsc() ? "tsc" : "coarse");
+    return 0;
+}
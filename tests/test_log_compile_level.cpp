@@ -0,0 +1,54 @@
+/**
+ * @file test_log_compile_level.cpp
+ * @brief 低于编译期最低级别的日志调用被整体消除，日志器和参数都不求值
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+//去掉所有DEBUG日志，与 -DKAFKA_LOG_COMPILE_MIN_LEVEL=2 相同
+#define KAFKA_LOG_COMPILE_MIN_LEVEL 2
+#include <stdio.h>
+#include <string>
+#include "test_helper.h"
+
+static int s_loggerCalls = 0;
+static int s_argCalls = 0;
+
+static KAFKA::Logger::LoggerPtr getLogger(const KAFKA::Logger::LoggerPtr &logger) {
+    ++s_loggerCalls;
+    return logger;
+}
+
+static int arg(int value) {
+    ++s_argCalls;
+    return value;
+}
+
+int main(int argc, char **argv) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("compile"));
+    logger->setLevel(KAFKA::LogLevel::DEBUG);
+    LineAppender::LineAppenderPtr appender(new LineAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m")));
+    logger->addAppender(appender);
+
+    //运行期级别允许DEBUG，编译期已经去掉
+    KAFKA_LOG_DEBUG(getLogger(logger)) << "debug " << arg(1);
+    KAFKA_LOG_FMT_DEBUG(getLogger(logger), "debug %d", arg(2));
+    KAFKA_LOG_LEVEL_IF(getLogger(logger), KAFKA::LogLevel::DEBUG, arg(3) > 0) << "debug " << arg(4);
+    if (!check(s_loggerCalls == 0 && s_argCalls == 0, "debug call evaluated nothing")
+        || !check(appender->lines.empty(), "debug call produced no output")) {
+        return 1;
+    }
+
+    //保留的级别正常输出，日志器只求值一次
+    KAFKA_LOG_INFO(getLogger(logger)) << "info " << arg(5);
+    KAFKA_LOG_FMT_WARN(getLogger(logger), "warn %d", arg(6));
+    if (!check(s_loggerCalls == 2 && s_argCalls == 2, "enabled calls evaluated once")
+        || !check(appender->lines.size() == 2 && appender->lines[0] == "info 5" && appender->lines[1] == "warn 6",
+                  "enabled calls produced output")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
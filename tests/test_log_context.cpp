@@ -0,0 +1,57 @@
+/**
+ * @file test_log_context.cpp
+ * @brief 日志事件的线程上下文
+ * @author ziv
+ * @email
+ * @date 22-11-21.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "test_helper.h"
+#include "../src/utils/utils.h"
+
+int main(int argc, char **argv) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger);
+    std::shared_ptr<LineAppender> appender(new LineAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%t %N %m%n")));
+    logger->addAppender(appender);
+
+    KAFKA::LogThreadContext::Current().setThreadName("main-thread");
+    KAFKA_LOG_INFO(logger) << "a";
+    std::thread worker([&] {
+        KAFKA::LogThreadContext::Current().setThreadName("worker");
+        KAFKA_LOG_FMT_INFO(logger, "%s", "b");
+    });
+    worker.join();
+    std::string tid = std::to_string(KAFKA::getThreadId());
+    if (!check(appender->lines.size() == 2 && appender->lines[0] == tid + " main-thread a\n"
+               && appender->lines[1].find(" worker b\n") != std::string::npos
+               && appender->lines[1].compare(0, tid.size() + 1, tid + " ") != 0, "thread id and name")) {
+        return 1;
+    }
+
+    //fork后子进程重新获取线程id
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(KAFKA::LogThreadContext::Current().getThreadId() == static_cast<uint32_t>(getpid()) ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "thread id after fork")) {
+        return 1;
+    }
+
+    uint32_t elapse = KAFKA::LogThreadContext::Elapse();
+    usleep(50 * 1000);
+    if (!check(KAFKA::LogThreadContext::Elapse() >= elapse + 40, "elapse")) {
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_log_dedup.cpp
+ * @brief 重复日志折叠
+ * @author ziv
+ * @email
+ * @date 22-11-18.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include "test_helper.h"
+
+int main(int argc, char **argv) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger);
+    std::shared_ptr<LineAppender> appender(new LineAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%p %m%n")));
+    logger->addAppender(appender);
+    //窗口足够长，定时线程不会在测试过程中补输出汇总
+    const uint32_t window = 60 * 1000;
+    logger->setDedupWindow(window);
+
+    for (int i = 0; i < 1000; ++i) {
+        KAFKA_LOG_ERROR(logger) << "disk full";
+    }
+    //内容不同或调用点不同都不折叠
+    KAFKA_LOG_ERROR(logger) << "disk full";
+    KAFKA_LOG_WARN(logger) << "recovered";
+    std::vector<std::string> expect = {"ERROR disk full\n", "ERROR last message repeated 999 times\n",
+                                       "ERROR disk full\n", "WARN recovered\n"};
+    if (!check(appender->lines == expect, "folded by site and content")) {
+        return 1;
+    }
+
+    //窗口结束后由定时检查补输出汇总，直接传入窗口结束后的时间
+    appender->lines.clear();
+    for (int i = 0; i < 10; ++i) {
+        KAFKA_LOG_INFO(logger) << "retry " << 1;
+    }
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    KAFKA::LoggerMgr::GetInstance()->expireDedupLoggers(now);
+    expect = {"INFO retry 1\n"};
+    if (!check(appender->lines == expect, "no summary inside window")) {
+        return 1;
+    }
+    KAFKA::LoggerMgr::GetInstance()->expireDedupLoggers(now + window);
+    expect = {"INFO retry 1\n", "INFO last message repeated 9 times\n"};
+    if (!check(appender->lines == expect, "summary after window")) {
+        return 1;
+    }
+
+    //写日志的同时开关折叠，汇总至少代表一条被折叠的日志，输出行数不超过写入的条数
+    KAFKA::Logger::LoggerPtr toggled(new KAFKA::Logger("toggled"));
+    std::shared_ptr<CountAppender> counter(new CountAppender);
+    counter->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m%n")));
+    toggled->addAppender(counter);
+    std::atomic<bool> running(true);
+    std::thread setter([&]() {
+        while (running) {
+            toggled->setDedupWindow(window);
+            toggled->setDedupWindow(0);
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; ++t) {
+        writers.emplace_back([&]() {
+            for (int i = 0; i < 20000; ++i) {
+                KAFKA_LOG_INFO(toggled) << "same";
+            }
+        });
+    }
+    for (auto &item : writers) {
+        item.join();
+    }
+    running = false;
+    setter.join();
+    if (!check(counter->count > 0 && counter->count <= 40000, "toggled while logging")) {
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
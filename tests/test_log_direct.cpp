@@ -0,0 +1,100 @@
+/**
+ * @file test_log_direct.cpp
+ * @brief 带缓冲的输出目标直接格式化到自己的缓冲区，输出与先格式化再写入的方式一致
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "test_helper.h"
+
+static const char *kPattern = "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T[%p]%T[%c]%T%f:%l%T%m%n";
+
+/**
+ * @brief 记录直接格式化的次数
+ */
+class DirectFileAppender : public KAFKA::FileLogAppender {
+public:
+    typedef std::shared_ptr<DirectFileAppender> DirectFileAppenderPtr;
+
+    explicit DirectFileAppender(const std::string &filename) : KAFKA::FileLogAppender(filename) {}
+
+    bool logDirect(const std::shared_ptr<KAFKA::Logger> &logger, KAFKA::LogLevel::Level level,
+                   const KAFKA::LogEvent::LogEventPtr &event) override {
+        bool direct = KAFKA::FileLogAppender::logDirect(logger, level, event);
+        directs += direct;
+        return direct;
+    }
+
+    int directs = 0;
+};
+
+static DirectFileAppender::DirectFileAppenderPtr makeAppender(const std::string &filename,
+                                                              const KAFKA::LogFormatter::LogFormatterPtr &formatter) {
+    DirectFileAppender::DirectFileAppenderPtr appender(new DirectFileAppender(filename));
+    appender->setFormatter(formatter);
+    KAFKA::FlushPolicy policy;
+    policy.bytes = 4096;
+    policy.interval = 0;
+    appender->setFlushPolicy(policy);
+    return appender;
+}
+
+static std::string readFile(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+int main(int argc, char **argv) {
+    const int count = 1000;
+    std::string prefix = "/tmp/kafka_test_log_direct." + std::to_string(getpid());
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("direct"));
+    //direct独占格式器走logDirect，shared0和shared1共用格式器，staged开启暂存，后两种都先格式化再写入
+    auto direct = makeAppender(prefix + ".direct", KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter(kPattern)));
+    KAFKA::LogFormatter::LogFormatterPtr shared(new KAFKA::LogFormatter(kPattern));
+    auto shared0 = makeAppender(prefix + ".shared0", shared);
+    auto shared1 = makeAppender(prefix + ".shared1", shared);
+    auto staged = makeAppender(prefix + ".staged", KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter(kPattern)));
+    staged->setStaging(true);
+    DirectFileAppender::DirectFileAppenderPtr appenders[] = {direct, shared0, shared1, staged};
+    for (auto &item : appenders) {
+        logger->addAppender(item);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        KAFKA_LOG_INFO(logger) << "message " << i << " " << std::string(i % 50, 'x');
+    }
+    //达到刷新级别时立即写出
+    KAFKA_LOG_ERROR(logger) << "error";
+    std::string written = readFile(prefix + ".direct");
+    bool flushedByLevel = written.size() > 6 && written.compare(written.size() - 6, 6, "error\n") == 0;
+    for (auto &item : appenders) {
+        item->flush();
+    }
+
+    std::string expect = readFile(prefix + ".shared0");
+    bool same = true;
+    for (auto suffix : {".direct", ".shared1", ".staged"}) {
+        same = same && readFile(prefix + suffix) == expect;
+    }
+    for (auto suffix : {".direct", ".shared0", ".shared1", ".staged"}) {
+        unlink((prefix + suffix).c_str());
+    }
+    if (!check(direct->directs == count + 1, "own formatter uses logDirect")
+        || !check(shared0->directs == 0 && shared1->directs == 0, "shared formatter formats once")
+        || !check(staged->directs == 0, "staging appender does not use logDirect")
+        || !check(flushedByLevel, "flushed by level")
+        || !check(!expect.empty() && same, "logDirect output matches formatted output")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
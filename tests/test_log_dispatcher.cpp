@@ -0,0 +1,117 @@
+/**
+ * @file test_log_dispatcher.cpp
+ * @brief 异步分发: 同一生产者保持顺序，队列满时等待，停止时不丢失
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "test_helper.h"
+#include "../src/log/logDispatcher.h"
+
+/**
+ * @brief 第一次写入时阻塞一段时间，让生产者把队列写满
+ */
+class SlowAppender : public LineAppender {
+protected:
+    void writeBuffer(const char *data, size_t len) override {
+        if (lines.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        LineAppender::writeBuffer(data, len);
+    }
+};
+
+/**
+ * @brief 每个生产者的日志都在且保持顺序
+ */
+static bool checkLines(const std::vector<std::string> &lines, int threads, int count) {
+    std::vector<int> next(threads, 0);
+    for (auto &line : lines) {
+        int t, n;
+        if (sscanf(line.c_str(), "t%d n%d", &t, &n) != 2 || t < 0 || t >= threads) {
+            printf("FAILED: corrupted line '%s'\n", line.c_str());
+            return false;
+        }
+        if (n != next[t]) {
+            printf("FAILED: t%d expect n%d got n%d\n", t, next[t], n);
+            return false;
+        }
+        ++next[t];
+    }
+    for (int t = 0; t < threads; ++t) {
+        if (next[t] != count) {
+            printf("FAILED: t%d got %d of %d\n", t, next[t], count);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 多个生产者写入，stopAfter不为0时在写入过程中停止分发器
+ */
+static bool run(int threads, int count, int stopAfter) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("dispatch"));
+    std::shared_ptr<SlowAppender> appender(new SlowAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m")));
+    logger->addAppender(appender);
+    //容量很小，消费线程阻塞时生产者走队列满的等待
+    KAFKA::AsyncLogDispatcher::AsyncLogDispatcherPtr dispatcher(new KAFKA::AsyncLogDispatcher(64));
+    logger->setDispatcher(dispatcher);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < count; ++i) {
+                KAFKA_LOG_FMT_INFO(logger, "t%d n%d", t, i);
+            }
+        });
+    }
+    if (stopAfter) {
+        while (dispatcher->getFullWaits() == 0) {
+            std::this_thread::yield();
+        }
+        dispatcher->stop();
+    }
+    for (auto &item : workers) {
+        item.join();
+    }
+    dispatcher->stop();
+    return check(dispatcher->getFullWaits() > 0, "producers waited on a full queue")
+           && checkLines(appender->lines, threads, count);
+}
+
+int main(int argc, char **argv) {
+    if (!run(4, 20000, 0) || !run(4, 20000, 1)) {
+        return 1;
+    }
+
+    //停止后在调用线程直接输出
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("stopped"));
+    LineAppender::LineAppenderPtr appender(new LineAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m")));
+    logger->addAppender(appender);
+    KAFKA::AsyncLogDispatcher::AsyncLogDispatcherPtr dispatcher(new KAFKA::AsyncLogDispatcher(64));
+    dispatcher->stop();
+    logger->setDispatcher(dispatcher);
+    KAFKA_LOG_INFO(logger) << "sync";
+    if (!check(appender->lines.size() == 1 && appender->lines[0] == "sync", "output after stop")) {
+        return 1;
+    }
+
+    //重新启动后恢复异步输出
+    dispatcher->start();
+    KAFKA_LOG_INFO(logger) << "async";
+    dispatcher->stop();
+    if (!check(appender->lines.size() == 2 && appender->lines[1] == "async", "output after restart")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_log_formatter.cpp
+ * @brief 操作码格式器和编译期格式器的输出与原先基于ostream的格式化逐字节一致
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include "test_helper.h"
+
+/**
+ * @brief 原先的格式化方式: 每一项输出到ostream，时间用strftime
+ * @details pattern只包含 %x、%x{...} 和普通字符
+ */
+static std::string reference(const std::string &pattern, KAFKA::LogLevel::Level level,
+                             const KAFKA::LogEvent::LogEventPtr &event) {
+    std::ostringstream os;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%') {
+            os << pattern[i];
+            continue;
+        }
+        char c = pattern[++i];
+        std::string arg;
+        if (i + 1 < pattern.size() && pattern[i + 1] == '{') {
+            size_t end = pattern.find('}', i);
+            arg = pattern.substr(i + 2, end - i - 2);
+            i = end;
+        }
+        switch (c) {
+            case 'm': os << event->getContent().toString(); break;
+            case 'p': os << KAFKA::LogLevel::toString(level); break;
+            case 'r': os << event->getElapse(); break;
+            case 'c': os << event->getThreadName(); break;
+            case 't': os << event->getThreadId(); break;
+            case 'n': os << std::endl; break;
+            case 'd': {
+                struct tm tm;
+                time_t time = event->getTime();
+                localtime_r(&time, &tm);
+                char buf[1000];
+                strftime(buf, sizeof(buf), arg.empty() ? "%Y-%m-%d %H:%M:%S" : arg.c_str(), &tm);
+                os << buf;
+                break;
+            }
+            case 'f': os << event->getFile(); break;
+            case 'l': os << event->getLine(); break;
+            case 'T': os << "\t"; break;
+            case 'F': os << event->getFiberId(); break;
+            case 'N': os << event->getThreadName(); break;
+            default: break;
+        }
+    }
+    return os.str();
+}
+
+static std::string render(KAFKA::LogFormatter &formatter, KAFKA::LogLevel::Level level,
+                          const KAFKA::LogEvent::LogEventPtr &event) {
+    KAFKA::LogBuffer buf;
+    formatter.format(buf, event->getLogger(), level, event);
+    return buf.toString();
+}
+
+static bool compare(KAFKA::LogFormatter &formatter, const std::string &pattern,
+                    const std::vector<KAFKA::LogEvent::LogEventPtr> &events) {
+    const KAFKA::LogLevel::Level levels[] = {KAFKA::LogLevel::DEBUG, KAFKA::LogLevel::INFO, KAFKA::LogLevel::WARN,
+                                             KAFKA::LogLevel::ERROR, KAFKA::LogLevel::FATAL};
+    for (auto &event : events) {
+        for (auto level : levels) {
+            std::string expect = reference(pattern, level, event);
+            std::string got = render(formatter, level, event);
+            if (got != expect) {
+                printf("FAILED: pattern '%s' expect '%s' got '%s'\n", pattern.c_str(), expect.c_str(), got.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 每个编译期组成项单独比较，pattern取自组成项本身
+ */
+template<class... Items>
+struct CompareStatic;
+
+template<>
+struct CompareStatic<> {
+    static bool run(const std::vector<KAFKA::LogEvent::LogEventPtr> &events) {return true;}
+};
+
+template<class Item, class... Items>
+struct CompareStatic<Item, Items...> {
+    static bool run(const std::vector<KAFKA::LogEvent::LogEventPtr> &events) {
+        KAFKA::StaticLogFormatter<Item> formatter;
+        return compare(formatter, formatter.getPattern(), events) && CompareStatic<Items...>::run(events);
+    }
+};
+
+KAFKA_PATTERN_STRING(SlashTime, "%Y/%m/%d %H:%M:%S");
+KAFKA_PATTERN_STRING(Arrow, " -> ");
+
+int main(int argc, char **argv) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("formatter"));
+    std::vector<KAFKA::LogEvent::LogEventPtr> events;
+    KAFKA::LogEvent::LogEventPtr event(new KAFKA::LogEvent(logger, KAFKA::LogLevel::INFO, "dir/file.cpp", 88, 12345,
+                                                           4321, 7, 0, "worker"));
+    event->setTime(1668000000, 123456789);
+    event->getSS() << "hello " << 42 << " " << 1.5;
+    events.push_back(event);
+    //边界值
+    event.reset(new KAFKA::LogEvent(logger, KAFKA::LogLevel::INFO, "", -1, 0, UINT32_MAX, 0, 0, ""));
+    event->setTime(0, 0);
+    events.push_back(event);
+    event.reset(new KAFKA::LogEvent(logger, KAFKA::LogLevel::INFO, "a.cpp", INT32_MAX, UINT32_MAX, 0, UINT32_MAX, 0,
+                                    "main"));
+    event->setTime(1700000000, 999999999);
+    event->getSS() << std::string(5000, 'x');
+    events.push_back(event);
+
+    const char *patterns[] = {"%m", "%p", "%r", "%c", "%t", "%n", "%d", "%d{%Y/%m/%d %H:%M:%S}", "%d{%j %a %b %%}",
+                              "%f", "%l", "%T", "%F", "%N", "literal only", "[%p]%T%f:%l -> %m%n",
+                              "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n"};
+    for (auto pattern : patterns) {
+        KAFKA::LogFormatter formatter(pattern);
+        if (!check(!formatter.isError(), pattern) || !compare(formatter, pattern, events)) {
+            return 1;
+        }
+    }
+
+    namespace p = KAFKA::pattern;
+    if (!CompareStatic<p::Message, p::Level, p::Elapse, p::Name, p::ThreadId, p::NewLine, p::DateTime<>,
+                       p::DateTime<SlashTime>, p::Filename, p::Line, p::Tab, p::FiberId, p::ThreadName,
+                       p::Char<'['>, p::Literal<Arrow>>::run(events)) {
+        return 1;
+    }
+    KAFKA::DefaultStaticLogFormatter defaultFormatter;
+    if (!check(defaultFormatter.getPattern() == logger->getFormatter()->getPattern(), "default static pattern")
+        || !compare(defaultFormatter, defaultFormatter.getPattern(), events)) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file test_log_shared_formatter.cpp
+ * @brief 多个输出目标共用同一个格式器时，每条日志只格式化一次
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "test_helper.h"
+
+/**
+ * @brief 记录格式化次数
+ */
+class CountingFormatter : public KAFKA::LogFormatter {
+public:
+    typedef std::shared_ptr<CountingFormatter> CountingFormatterPtr;
+
+    explicit CountingFormatter(const std::string &pattern) : KAFKA::LogFormatter(pattern) {}
+
+    void format(KAFKA::LogBuffer &buf, const std::shared_ptr<KAFKA::Logger> &logger, KAFKA::LogLevel::Level level,
+                const KAFKA::LogEvent::LogEventPtr &event) override {
+        ++calls;
+        KAFKA::LogFormatter::format(buf, logger, level, event);
+    }
+
+    int calls = 0;
+};
+
+static LineAppender::LineAppenderPtr addAppender(const KAFKA::Logger::LoggerPtr &logger,
+                                                 const CountingFormatter::CountingFormatterPtr &formatter) {
+    LineAppender::LineAppenderPtr appender(new LineAppender);
+    appender->setFormatter(formatter);
+    logger->addAppender(appender);
+    return appender;
+}
+
+static bool expectLines(const LineAppender::LineAppenderPtr &appender, const std::vector<std::string> &lines,
+                        const char *what) {
+    if (appender->lines != lines) {
+        printf("FAILED: %s got %zu lines\n", what, appender->lines.size());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int count = 10;
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("shared"));
+    //a由三个输出目标共用，b只有一个输出目标
+    CountingFormatter::CountingFormatterPtr a(new CountingFormatter("[%p] %m%n"));
+    CountingFormatter::CountingFormatterPtr b(new CountingFormatter("%m|%n"));
+    std::vector<LineAppender::LineAppenderPtr> sharedAppenders;
+    for (int i = 0; i < 3; ++i) {
+        sharedAppenders.push_back(addAppender(logger, a));
+    }
+    LineAppender::LineAppenderPtr single = addAppender(logger, b);
+
+    std::vector<std::string> expectA, expectB;
+    for (int i = 0; i < count; ++i) {
+        KAFKA_LOG_INFO(logger) << "message " << i;
+        expectA.push_back("[INFO] message " + std::to_string(i) + "\n");
+        expectB.push_back("message " + std::to_string(i) + "|\n");
+    }
+    if (!check(a->calls == count, "shared formatter runs once per event")
+        || !check(b->calls == count, "single formatter runs once per event")) {
+        return 1;
+    }
+    for (auto &item : sharedAppenders) {
+        if (!expectLines(item, expectA, "shared appender")) {
+            return 1;
+        }
+    }
+    if (!expectLines(single, expectB, "single appender")) {
+        return 1;
+    }
+
+    //级别被过滤的输出目标不参与格式化
+    sharedAppenders[0]->setLevel(KAFKA::LogLevel::ERROR);
+    a->calls = 0;
+    KAFKA_LOG_INFO(logger) << "filtered";
+    if (!check(a->calls == 1 && sharedAppenders[0]->lines.size() == static_cast<size_t>(count)
+               && sharedAppenders[1]->lines.back() == "[INFO] filtered\n", "appender below its level")) {
+        return 1;
+    }
+
+    //加入后再设置格式器，立即按新的格式器输出，原来共用的输出目标不受影响
+    CountingFormatter::CountingFormatterPtr c(new CountingFormatter("%m!%n"));
+    sharedAppenders[2]->setFormatter(c);
+    a->calls = 0;
+    KAFKA_LOG_INFO(logger) << "changed";
+    if (!check(c->calls == 1 && sharedAppenders[2]->lines.back() == "changed!\n", "formatter set after add")
+        || !check(a->calls == 1 && sharedAppenders[1]->lines.back() == "[INFO] changed\n", "remaining shared")) {
+        return 1;
+    }
+
+    //超过kMaxSharedFormatters个不同格式器时，超出的输出目标各自格式化，输出仍然正确
+    KAFKA::Logger::LoggerPtr many(new KAFKA::Logger("many"));
+    std::vector<CountingFormatter::CountingFormatterPtr> formatters;
+    std::vector<LineAppender::LineAppenderPtr> appenders;
+    for (size_t i = 0; i <= KAFKA::Logger::kMaxSharedFormatters; ++i) {
+        formatters.emplace_back(new CountingFormatter(std::to_string(i) + " %m"));
+        appenders.push_back(addAppender(many, formatters.back()));
+        appenders.push_back(addAppender(many, formatters.back()));
+    }
+    KAFKA_LOG_INFO(many) << "event";
+    for (size_t i = 0; i < formatters.size(); ++i) {
+        std::string expect = std::to_string(i) + " event";
+        if (!check(appenders[i * 2]->lines.size() == 1 && appenders[i * 2]->lines[0] == expect
+                   && appenders[i * 2 + 1]->lines.size() == 1 && appenders[i * 2 + 1]->lines[0] == expect,
+                   "output with many formatters")) {
+            return 1;
+        }
+        if (i < KAFKA::Logger::kMaxSharedFormatters && !check(formatters[i]->calls == 1, "shared within limit")) {
+            return 1;
+        }
+    }
+    printf("OK\n");
+    return 0;
+}
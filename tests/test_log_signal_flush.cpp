@@ -0,0 +1,76 @@
+/**
+ * @file test_log_signal_flush.cpp
+ * @brief 收到致命信号时写出输出目标中缓冲的日志
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "test_helper.h"
+
+static KAFKA::FileLogAppender::FileLogAppenderPtr makeAppender(const std::string &filename, bool onSignal) {
+    KAFKA::FileLogAppender::FileLogAppenderPtr appender(new KAFKA::FileLogAppender(filename));
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m%n")));
+    //只在信号处理中写出
+    KAFKA::FlushPolicy policy;
+    policy.bytes = 1 << 20;
+    policy.interval = 0;
+    policy.level = KAFKA::LogLevel::FATAL;
+    policy.onSignal = onSignal;
+    appender->setFlushPolicy(policy);
+    return appender;
+}
+
+static void crash(const std::string &prefix) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("signal"));
+    //安装前已写入和安装后才写入的输出目标都要登记
+    logger->addAppender(makeAppender(prefix + ".before", true));
+    KAFKA_LOG_INFO(logger) << "first";
+    KAFKA::LoggerMgr::GetInstance()->installFlushSignalHandler();
+    logger->addAppender(makeAppender(prefix + ".after", true));
+    //未开启onSignal的输出目标不登记，保留引用以免析构时写出
+    KAFKA::FileLogAppender::FileLogAppenderPtr off = makeAppender(prefix + ".off", false);
+    logger->addAppender(off);
+    KAFKA_LOG_INFO(logger) << "second";
+    //日志器在信号处理前释放，登记的输出目标仍然有效
+    logger.reset();
+    abort();
+}
+
+static std::string readFile(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    unlink(filename.c_str());
+    return ss.str();
+}
+
+int main(int argc, char **argv) {
+    std::string prefix = "/tmp/kafka_test_signal_flush." + std::to_string(getpid());
+    pid_t pid = fork();
+    if (pid == 0) {
+        crash(prefix);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    std::string before = readFile(prefix + ".before");
+    std::string after = readFile(prefix + ".after");
+    std::string off = readFile(prefix + ".off");
+    if (!check(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT, "child aborted")
+        || !check(before == "first\nsecond\n", "appender registered before install")
+        || !check(after == "second\n", "appender registered after install")
+        || !check(off.empty(), "appender without onSignal")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
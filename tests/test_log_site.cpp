@@ -0,0 +1,114 @@
+/**
+ * @file test_log_site.cpp
+ * @brief 调用点登记和运行时开关
+ * @author ziv
+ * @email
+ * @date 22-11-17.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include "test_helper.h"
+
+static const int kStreamLine = __LINE__ + 4;
+static const int kFmtLine = __LINE__ + 4;
+
+static void logBoth(KAFKA::Logger::LoggerPtr logger, int i) {
+    KAFKA_LOG_INFO(logger) << "stream " << i;
+    KAFKA_LOG_FMT_INFO(logger, "fmt %d", i);
+}
+
+static const int kLaterLine = __LINE__ + 3;
+
+static void logLater(KAFKA::Logger::LoggerPtr logger) {
+    KAFKA_LOG_WARN(logger) << "later";
+}
+
+int main(int argc, char **argv) {
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger);
+    std::shared_ptr<CountAppender> appender(new CountAppender);
+    logger->addAppender(appender);
+    auto sites = KAFKA::LogSiteMgr::GetInstance();
+
+    //未执行的调用点不登记，按文件设置的规则在登记时应用
+    if (!check(sites->setEnabled("test_log_site.cpp", kLaterLine, false) == 0, "rule before registration")) {
+        return 1;
+    }
+    logLater(logger);
+    if (!check(appender->count == 0, "rule applied on registration")) {
+        return 1;
+    }
+    size_t before = sites->size();
+    logBoth(logger, 0);
+    if (!check(sites->size() == before + 2 && appender->count == 2, "sites registered once")) {
+        return 1;
+    }
+    logBoth(logger, 1);
+    if (!check(sites->size() == before + 2 && appender->count == 4, "sites reused")) {
+        return 1;
+    }
+
+    if (!check(sites->setEnabled("test_log_site.cpp", kStreamLine, false) == 1, "disable stream site")) {
+        return 1;
+    }
+    logBoth(logger, 2);
+    if (!check(appender->count == 5, "stream site disabled")) {
+        return 1;
+    }
+    //只匹配路径分隔处
+    if (!check(sites->setEnabled("log_site.cpp", kFmtLine, false) == 0, "partial file name")) {
+        return 1;
+    }
+
+    KAFKA::LogSite *fmt = nullptr;
+    sites->visit([&](KAFKA::LogSite &site) {
+        if (site.getLine() == kFmtLine && std::string(site.getFunction()) == "logBoth") {
+            fmt = &site;
+        }
+    });
+    if (!check(fmt && std::string(fmt->getFormat()) == "fmt %d" && fmt->getLevel() == KAFKA::LogLevel::INFO
+               && sites->get(fmt->getId()) == fmt, "site metadata")) {
+        return 1;
+    }
+    sites->setEnabled(fmt->getId(), false);
+    logBoth(logger, 3);
+    if (!check(appender->count == 5, "fmt site disabled by id")) {
+        return 1;
+    }
+
+    sites->setEnabled("test_log_site.cpp", 0, true);
+    logBoth(logger, 4);
+    logLater(logger);
+    if (!check(appender->count == 8, "whole file enabled")) {
+        return 1;
+    }
+
+    //限流: 跳过的调用不计算参数，通过时先补一条跳过的数量
+    int evaluated = 0;
+    appender->count = 0;
+    for (int i = 0; i < 100; ++i) {
+        KAFKA_LOG_EVERY_N(logger, KAFKA::LogLevel::ERROR, 10) << "every n " << ++evaluated;
+    }
+    if (!check(evaluated == 10 && appender->count == 10 + 9, "every n")) {
+        return 1;
+    }
+    appender->count = 0;
+    for (int i = 0; i < 100; ++i) {
+        KAFKA_LOG_FMT_EVERY_N(logger, KAFKA::LogLevel::ERROR, 50, "every n %d", i);
+        KAFKA_LOG_EVERY_MS(logger, KAFKA::LogLevel::ERROR, 60000) << "every ms " << ++evaluated;
+        KAFKA_LOG_SAMPLED(logger, KAFKA::LogLevel::ERROR, 0.0) << "never " << ++evaluated;
+    }
+    if (!check(evaluated == 11 && appender->count == 2 + 1 + 1, "every ms and sampled")) {
+        return 1;
+    }
+    appender->count = 0;
+    for (int i = 0; i < 100; ++i) {
+        KAFKA_LOG_SAMPLED(logger, KAFKA::LogLevel::ERROR, 1.0) << "always";
+    }
+    if (!check(appender->count == 100, "sampled all")) {
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
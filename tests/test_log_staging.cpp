@@ -0,0 +1,127 @@
+/**
+ * @file test_log_staging.cpp
+ * @brief 线程暂存缓冲区按阈值、定时和线程退出交给输出目标，并保持顺序，不妨碍删除的输出目标析构
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "test_helper.h"
+
+/**
+ * @brief 输出目标收到的全部内容
+ */
+static std::string joined(const LineAppender::LineAppenderPtr &appender) {
+    std::lock_guard<std::mutex> lock(appender->m_mutex);
+    std::string str;
+    for (auto &item : appender->lines) {
+        str.append(item);
+    }
+    return str;
+}
+
+static size_t batches(const LineAppender::LineAppenderPtr &appender) {
+    std::lock_guard<std::mutex> lock(appender->m_mutex);
+    return appender->lines.size();
+}
+
+/**
+ * @brief 清空收到的内容，定时线程可能同时交出暂存的日志，需加锁
+ */
+static void clearLines(const LineAppender::LineAppenderPtr &appender) {
+    std::lock_guard<std::mutex> lock(appender->m_mutex);
+    appender->lines.clear();
+}
+
+int main(int argc, char **argv) {
+    auto mgr = KAFKA::LoggerMgr::GetInstance();
+    KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("staging"));
+    LineAppender::LineAppenderPtr appender(new LineAppender);
+    appender->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m%n")));
+    appender->setStaging(true);
+    logger->addAppender(appender);
+
+    //定时刷新
+    mgr->setStagingThreshold(1 << 20);
+    mgr->setStagingInterval(20);
+    KAFKA_LOG_INFO(logger) << "timer 0";
+    KAFKA_LOG_INFO(logger) << "timer 1";
+    std::string expect = "timer 0\ntimer 1\n";
+    for (int i = 0; i < 200 && joined(appender) != expect; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!check(joined(appender) == expect, "flushed by interval")) {
+        return 1;
+    }
+
+    //超过阈值时整批交出，定时线程不再参与
+    mgr->setStagingInterval(60 * 1000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    mgr->setStagingThreshold(64);
+    clearLines(appender);
+    for (int i = 0; i < 10; ++i) {
+        KAFKA_LOG_INFO(logger) << "record " << i;
+    }
+    //每条9字节，第8条时超过阈值
+    expect.clear();
+    for (int i = 0; i < 8; ++i) {
+        expect += "record " + std::to_string(i) + "\n";
+    }
+    if (!check(batches(appender) == 1 && joined(appender) == expect, "flushed by threshold")) {
+        return 1;
+    }
+
+    //线程退出时交出剩余的日志
+    mgr->setStagingThreshold(1 << 20);
+    clearLines(appender);
+    std::thread worker([&]() {
+        for (int i = 0; i < 3; ++i) {
+            KAFKA_LOG_INFO(logger) << "worker " << i;
+        }
+    });
+    worker.join();
+    if (!check(joined(appender) == "worker 0\nworker 1\nworker 2\n", "flushed at thread exit")) {
+        return 1;
+    }
+
+    //主线程剩余的日志保持顺序
+    clearLines(appender);
+    mgr->flushStagingBuffers();
+    if (!check(joined(appender) == "record 8\nrecord 9\n", "remaining records in order")) {
+        return 1;
+    }
+
+    //删除后暂存的日志交出前保留输出目标，交出后释放
+    KAFKA_LOG_INFO(logger) << "last";
+    std::weak_ptr<LineAppender> weak = appender;
+    logger->delAppender(appender);
+    appender.reset();
+    if (!check(!weak.expired(), "appender kept while records are staged")) {
+        return 1;
+    }
+    mgr->flushStagingBuffers();
+    if (!check(weak.expired(), "removed appender destroyed after handoff")) {
+        return 1;
+    }
+
+    //没有暂存的日志时不持有输出目标
+    LineAppender::LineAppenderPtr other(new LineAppender);
+    other->setFormatter(KAFKA::LogFormatter::LogFormatterPtr(new KAFKA::LogFormatter("%m%n")));
+    other->setStaging(true);
+    logger->addAppender(other);
+    mgr->setStagingThreshold(1);
+    KAFKA_LOG_INFO(logger) << "handed off";
+    weak = other;
+    logger->delAppender(other);
+    other.reset();
+    if (!check(weak.expired(), "appender without staged records destroyed")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
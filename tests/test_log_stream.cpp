@@ -0,0 +1,73 @@
+/**
+ * @file test_log_stream.cpp
+ * @brief LogStream的输出与std::ostringstream一致，操纵符的格式对之后的输出持续生效
+ * @author ziv
+ * @email
+ * @date 22-11-22.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include "test_helper.h"
+
+struct Point {
+    int x;
+    int y;
+};
+
+static std::ostream& operator<<(std::ostream &os, const Point &p) {
+    return os << '(' << p.x << ',' << p.y << ')';
+}
+
+/**
+ * @brief 同一组输出分别写入LogStream和std::ostringstream后比较
+ */
+#define EXPECT_SAME(what, ...) \
+    do { \
+        KAFKA::LogStream ls; \
+        std::ostringstream os; \
+        ls __VA_ARGS__; \
+        os __VA_ARGS__; \
+        if (ls.str() != os.str()) { \
+            printf("FAILED: %s expect '%s' got '%s'\n", what, os.str().c_str(), ls.str().c_str()); \
+            return 1; \
+        } \
+    } while (0)
+
+int main(int argc, char **argv) {
+    const void *ptr = reinterpret_cast<const void*>(0x1234abcd);
+    std::string str = "text";
+    Point point = {3, -4};
+
+    //默认格式走快速路径
+    EXPECT_SAME("default", << 255 << ' ' << -7 << ' ' << 42u << ' ' << 1.5 << ' ' << 0.1f << ' ' << true
+                           << ' ' << 'c' << ' ' << "cstr" << ' ' << str << ' ' << ptr << ' ' << point);
+    EXPECT_SAME("integer limits", << INT64_MIN << ' ' << UINT64_MAX << ' ' << static_cast<short>(-1));
+
+    //操纵符
+    EXPECT_SAME("hex and setw", << std::hex << 255 << std::setw(6) << 7);
+    EXPECT_SAME("hex persists", << std::hex << 255 << ' ' << 4096 << std::dec << ' ' << 10);
+    EXPECT_SAME("showbase uppercase", << std::showbase << std::uppercase << std::hex << 255 << ' ' << std::oct << 8);
+    EXPECT_SAME("setfill left", << std::setfill('0') << std::setw(5) << 42 << '|' << std::left << std::setw(5) << 42
+                                << '|');
+    EXPECT_SAME("setw applies once", << std::setw(8) << "ab" << "cd" << std::setw(4) << str << point);
+    EXPECT_SAME("precision", << std::setprecision(3) << 3.14159 << ' ' << std::fixed << 2.0 << ' '
+                             << std::scientific << 12345.678);
+    EXPECT_SAME("boolalpha", << std::boolalpha << true << ' ' << false << std::noboolalpha << ' ' << true);
+    EXPECT_SAME("showpos", << std::showpos << 5 << ' ' << 0 << ' ' << 1.5);
+    EXPECT_SAME("char width", << std::setw(3) << 'x' << std::setw(3) << static_cast<unsigned char>('y'));
+    EXPECT_SAME("endl", << "line" << std::endl << std::hex << 10 << std::endl);
+
+    //clear后恢复默认格式，和新的事件一样
+    KAFKA::LogStream ls;
+    ls << std::hex << std::setw(4) << std::setprecision(2) << 255;
+    ls.clear();
+    ls << 255 << ' ' << 3.14159;
+    if (!check(ls.str() == "255 3.14159", "format reset by clear")) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file test_logger_registry.cpp
+ * @brief 多线程并发创建和查找日志器
+ * @author ziv
+ * @email
+ * @date 22-11-13.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/log/logInclude.h"
+
+int main(int argc, char **argv) {
+    const int threads = 8;
+    const int loggers = 500;
+    auto mgr = KAFKA::LoggerMgr::GetInstance();
+
+    //每个线程按不同顺序创建同一组日志器，记录拿到的指针
+    std::vector<std::vector<KAFKA::Logger*>> seen(threads, std::vector<KAFKA::Logger*>(loggers));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < loggers; ++i) {
+                int idx = (i * 7 + t * 61) % loggers;
+                seen[t][idx] = mgr->getLogger("module." + std::to_string(idx)).get();
+            }
+        });
+    }
+    for (auto &item : workers) {
+        item.join();
+    }
+
+    for (int i = 0; i < loggers; ++i) {
+        KAFKA::LoggerHandle handle = mgr->getLoggerHandle("module." + std::to_string(i));
+        for (int t = 0; t < threads; ++t) {
+            if (seen[t][i] != handle.get()) {
+                printf("FAILED: logger module.%d is not unique\n", i);
+                return 1;
+            }
+        }
+        if (handle->getName() != "module." + std::to_string(i) || handle->getRootLogger() != mgr->getRoot()) {
+            printf("FAILED: logger module.%d is not initialized\n", i);
+            return 1;
+        }
+    }
+
+    KAFKA::LoggerHandle handle = mgr->getLoggerHandle("module.0");
+    handle->setLevel(KAFKA::LogLevel::FATAL);
+    KAFKA_LOG_INFO(handle) << "filtered";
+    KAFKA_LOG_FMT_INFO(handle, "filtered %d", 1);
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file test_mmap_appender.cpp
+ * @brief 多线程写入内存映射文件，跨窗口不丢失、不交错；扩展文件失败后文件中没有未写入的'\0'
+ * @author ziv
+ * @email
+ * @date 22-11-15.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include "../src/log/logInclude.h"
+
+/**
+ * @brief 文件长度受限，扩展到第7个窗口时失败，跨越该窗口的一条日志放弃未写入的部分
+ * @details 析构前解除限制，截断到预留的末尾时会在文件中留下'\0'
+ */
+static bool failedExtend(const char *path) {
+    const size_t window = 4096;
+    struct rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    rlim_t saved = limit.rlim_cur;
+    limit.rlim_cur = 6 * window;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    uint64_t offset = 0;
+    {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("mmap"));
+        logger->setFormatter("%m%n");
+        KAFKA::MmapFileLogAppender::MmapFileLogAppenderPtr appender(new KAFKA::MmapFileLogAppender(path, window));
+        logger->addAppender(appender);
+        KAFKA_LOG_INFO(logger) << std::string(7 * window, 'x');
+        offset = appender->getOffset();
+        limit.rlim_cur = saved;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        if (appender->isOk() || offset <= 6 * window) {
+            return false;
+        }
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    //截断到第一个未映射的窗口，之前的内容全部写入
+    return ss.str() == std::string(6 * window, 'x');
+}
+
+int main(int argc, char **argv) {
+    char path[] = "/tmp/kafka_mmap_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return 1;
+    }
+    close(fd);
+
+    const int threads = 4;
+    const int lines = 20000;
+    for (int round = 0; round < 2; ++round) {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("mmap"));
+        logger->setFormatter("%m%n");
+        //小窗口，覆盖跨窗口写入和窗口切换
+        KAFKA::MmapFileLogAppender::MmapFileLogAppenderPtr appender(new KAFKA::MmapFileLogAppender(path, 4096));
+        logger->addAppender(appender);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (int i = 0; i < lines; ++i) {
+                    KAFKA_LOG_FMT_INFO(logger, "r%d t%d n%d", round, t, i);
+                }
+            });
+        }
+        for (auto &item : workers) {
+            item.join();
+        }
+        if (!appender->isOk()) {
+            printf("FAILED: appender error\n");
+            return 1;
+        }
+    }
+
+    std::ifstream in(path);
+    std::string line;
+    std::vector<std::vector<int>> next(2 * threads, std::vector<int>(1, 0));
+    size_t count = 0;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        int r, t, n;
+        if (sscanf(line.c_str(), "r%d t%d n%d", &r, &t, &n) != 3 || r < 0 || r > 1 || t < 0 || t >= threads) {
+            printf("FAILED: corrupted line '%s'\n", line.c_str());
+            return 1;
+        }
+        //同一线程的日志保持顺序
+        int &expect = next[r * threads + t][0];
+        if (n != expect) {
+            printf("FAILED: r%d t%d expect n%d got n%d\n", r, t, expect, n);
+            return 1;
+        }
+        ++expect;
+        ++count;
+    }
+    unlink(path);
+    if (count != static_cast<size_t>(2 * threads * lines)) {
+        printf("FAILED: %zu lines\n", count);
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGXFSZ, SIG_IGN);
+        _exit(failedExtend(path) ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    unlink(path);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("FAILED: extend failure left unwritten bytes\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file test_rolling_appender.cpp
+ * @brief 滚动文件输出和LZ4压缩
+ * @author ziv
+ * @email
+ * @date 22-11-14.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include "../src/log/logInclude.h"
+#include "../src/log/logCompress.h"
+
+static std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static bool roundTrip(const std::string &data) {
+    std::vector<char> compressed(KAFKA::LogCompress::CompressBound(data.size()));
+    size_t len = KAFKA::LogCompress::CompressBlock(data.data(), data.size(), &compressed[0]);
+    std::string out;
+    return KAFKA::LogCompress::DecompressBlock(&compressed[0], len, out) && out == data;
+}
+
+int main(int argc, char **argv) {
+    //块编码
+    std::string text;
+    for (int i = 0; i < 20000; ++i) {
+        text += "2022-11-14 10:00:00\t1\tmain\t2\t[INFO]\t[main]\ttest.cpp:" + std::to_string(i % 97) + "\tmessage\n";
+    }
+    std::string random;
+    srand(1);
+    for (int i = 0; i < 100000; ++i) {
+        random.push_back(static_cast<char>(rand()));
+    }
+    if (!roundTrip("") || !roundTrip("abc") || !roundTrip(std::string(1000, 'a')) || !roundTrip(text) || !roundTrip(random)) {
+        printf("FAILED: block round trip\n");
+        return 1;
+    }
+
+    //滚动和压缩
+    char dir[] = "/tmp/kafka_rolling_XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("FAILED: mkdtemp\n");
+        return 1;
+    }
+    std::string filename = std::string(dir) + "/app.log";
+    const int lines = 5000;
+    {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("rolling"));
+        KAFKA::RollingFileLogAppender::RollingFileLogAppenderPtr appender(
+            new KAFKA::RollingFileLogAppender(filename, 64 * 1024, 0));
+        logger->addAppender(appender);
+        for (int i = 0; i < lines; ++i) {
+            KAFKA_LOG_FMT_INFO(logger, "line %d", i);
+        }
+        appender->waitBackground();
+    }
+
+    //按文件名排序即为时间顺序，当前文件在最后
+    std::vector<std::string> segments;
+    DIR *d = opendir(dir);
+    while (struct dirent *entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".lz4") == 0) {
+            segments.push_back(name);
+        }
+        else if (name != "." && name != ".." && name != "app.log") {
+            printf("FAILED: unexpected file %s\n", name.c_str());
+            return 1;
+        }
+    }
+    closedir(d);
+    if (segments.size() < 2) {
+        printf("FAILED: expected rolled segments, got %zu\n", segments.size());
+        return 1;
+    }
+    //app.log.YYYYmmdd-HHMMSS[.N].lz4，先按时间再按序号排序
+    auto order = [](const std::string &name) {
+        const size_t stamp = strlen("app.log.YYYYmmdd-HHMMSS");
+        return std::make_pair(name.substr(0, stamp), atoi(name.c_str() + stamp + 1));
+    };
+    std::sort(segments.begin(), segments.end(), [&order](const std::string &a, const std::string &b) {
+        return order(a) < order(b);
+    });
+
+    std::string all;
+    for (auto &name : segments) {
+        std::string path = std::string(dir) + "/" + name;
+        std::string frame = readFile(path);
+        std::string content;
+        if (!KAFKA::LogCompress::DecompressFrame(frame.data(), frame.size(), content)) {
+            printf("FAILED: bad frame %s\n", name.c_str());
+            return 1;
+        }
+        if (content.size() > 64 * 1024) {
+            printf("FAILED: segment %s too large\n", name.c_str());
+            return 1;
+        }
+        all += content;
+        unlink(path.c_str());
+    }
+    all += readFile(filename);
+    unlink(filename.c_str());
+    rmdir(dir);
+
+    size_t pos = 0;
+    for (int i = 0; i < lines; ++i) {
+        std::string expect = "\tline " + std::to_string(i) + "\n";
+        pos = all.find(expect, pos);
+        if (pos == std::string::npos) {
+            printf("FAILED: line %d lost\n", i);
+            return 1;
+        }
+        pos += expect.size();
+    }
+
+    //未压缩的文件滚动后不占用预分配的空间
+    char dir2[] = "/tmp/kafka_rolling_XXXXXX";
+    if (!mkdtemp(dir2)) {
+        printf("FAILED: mkdtemp\n");
+        return 1;
+    }
+    filename = std::string(dir2) + "/app.log";
+    const uint64_t rollSize = 64 * 1024 * 1024;
+    std::vector<std::string> archives;
+    {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("reserved"));
+        KAFKA::RollingFileLogAppender::RollingFileLogAppenderPtr appender(
+            new KAFKA::RollingFileLogAppender(filename, rollSize, 0, false));
+        logger->addAppender(appender);
+        //第一次滚动后当前文件才是预分配的文件
+        for (int i = 0; i < 2; ++i) {
+            KAFKA_LOG_INFO(logger) << "reserved " << i;
+            appender->waitBackground();
+            appender->roll();
+        }
+        appender->waitBackground();
+        d = opendir(dir2);
+        while (struct dirent *entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != ".." && name != "app.log" && name != "app.log.next") {
+                archives.push_back(std::string(dir2) + "/" + name);
+            }
+        }
+        closedir(d);
+    }
+    if (archives.size() != 2) {
+        printf("FAILED: expected 2 archived segments, got %zu\n", archives.size());
+        return 1;
+    }
+    for (auto &path : archives) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_blocks) * 512 >= rollSize / 2) {
+            printf("FAILED: archived segment %s keeps reserved space\n", path.c_str());
+            return 1;
+        }
+        unlink(path.c_str());
+    }
+    unlink(filename.c_str());
+    rmdir(dir2);
+
+    printf("OK %zu segments\n", segments.size());
+    return 0;
+}
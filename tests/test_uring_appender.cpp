@@ -0,0 +1,165 @@
+/**
+ * @file test_uring_appender.cpp
+ * @brief io_uring和pwrite线程池两种方式写入，内容完整，达到刷新级别时不等待写入完成
+ * @author ziv
+ * @email
+ * @date 22-11-16.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include "../src/log/logInclude.h"
+
+static bool run(bool useUring) {
+    char path[] = "/tmp/kafka_uring_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return false;
+    }
+    close(fd);
+
+    const int threads = 4;
+    const int lines = 50000;
+    uint64_t dropped = 0;
+    {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("uring"));
+        logger->setFormatter("%m%n");
+        KAFKA::UringFileLogAppender::UringFileLogAppenderPtr appender(
+            new KAFKA::UringFileLogAppender(path, 1, useUring));
+        logger->addAppender(appender);
+        printf("%s backend\n", appender->isUring() ? "io_uring" : "pwrite");
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (int i = 0; i < lines; ++i) {
+                    KAFKA_LOG_FMT_INFO(logger, "t%d n%d", t, i);
+                    //给后台留出写入时间，避免测试中丢弃
+                    if (i % 5000 == 0) {
+                        appender->flush();
+                    }
+                }
+            });
+        }
+        for (auto &item : workers) {
+            item.join();
+        }
+        appender->flush();
+        dropped = appender->getDropped();
+    }
+
+    std::ifstream in(path);
+    std::string line;
+    std::vector<int> next(threads, 0);
+    size_t count = 0;
+    while (std::getline(in, line)) {
+        int t, n;
+        if (line.empty() || line.compare(0, 7, "Dropped") == 0) {
+            continue;
+        }
+        if (sscanf(line.c_str(), "t%d n%d", &t, &n) != 2 || t < 0 || t >= threads || n < next[t]) {
+            printf("FAILED: corrupted line '%s'\n", line.c_str());
+            return false;
+        }
+        next[t] = n + 1;
+        ++count;
+    }
+    unlink(path);
+    if (dropped == 0 && count != static_cast<size_t>(threads * lines)) {
+        printf("FAILED: %zu lines\n", count);
+        return false;
+    }
+    printf("%zu lines, %lu bytes dropped\n", count, static_cast<unsigned long>(dropped));
+    return true;
+}
+
+/**
+ * @brief 空闲缓冲区放不下的日志整条丢弃，文件中不出现半条日志
+ */
+static bool runOversized(bool useUring) {
+    char path[] = "/tmp/kafka_uring_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return false;
+    }
+    close(fd);
+
+    const size_t size = KAFKA::UringFileLogAppender::kBufferCount * KAFKA::UringFileLogAppender::kBufferSize;
+    uint64_t dropped = 0;
+    {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("uring"));
+        logger->setFormatter("%m%n");
+        KAFKA::UringFileLogAppender::UringFileLogAppenderPtr appender(
+            new KAFKA::UringFileLogAppender(path, 1, useUring));
+        logger->addAppender(appender);
+        KAFKA_LOG_INFO(logger) << "before";
+        KAFKA_LOG_INFO(logger) << std::string(size, 'x');
+        KAFKA_LOG_INFO(logger) << "after";
+        appender->flush();
+        dropped = appender->getDropped();
+    }
+
+    std::ifstream in(path);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    unlink(path);
+    std::string expect = "before\nDropped log messages, " + std::to_string(size + 1) + " bytes\nafter\n";
+    if (dropped != size + 1 || content != expect) {
+        printf("FAILED: oversized record, %lu bytes dropped, %zu bytes written\n",
+               static_cast<unsigned long>(dropped), content.size());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 达到刷新级别的日志只把缓冲区交给后台，不调用flush也会写入文件
+ */
+static bool runFlushLevel(bool useUring) {
+    char path[] = "/tmp/kafka_uring_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAILED: mkstemp\n");
+        return false;
+    }
+    close(fd);
+
+    std::string content;
+    {
+        KAFKA::Logger::LoggerPtr logger(new KAFKA::Logger("uring"));
+        logger->setFormatter("%m%n");
+        //超时远大于等待时间，只有交出缓冲区才会写入
+        KAFKA::UringFileLogAppender::UringFileLogAppenderPtr appender(
+            new KAFKA::UringFileLogAppender(path, 60, useUring));
+        logger->addAppender(appender);
+        KAFKA_LOG_INFO(logger) << "info";
+        KAFKA_LOG_ERROR(logger) << "error";
+        for (int i = 0; i < 200 && content != "info\nerror\n"; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::ifstream in(path);
+            content.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        }
+    }
+    unlink(path);
+    if (content != "info\nerror\n") {
+        printf("FAILED: error record not handed off, %zu bytes written\n", content.size());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (!run(true) || !run(false) || !runOversized(true) || !runOversized(false)
+        || !runFlushLevel(true) || !runFlushLevel(false)) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file kafka_logdecode.cpp
+ * @brief 二进制日志解码工具，将Logger::setBinaryLogFile写出的文件还原为文本日志
+ * @author ziv
+ * @email
+ * @date 22-11-12.
+ * @copyright Copyright (c) 2022年 ziv All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+#include "../src/log/log.h"
+
+namespace {
+
+struct Site {
+    int32_t line;
+    std::string file;
+    std::string format;
+    std::string argTypes;
+};
+
+/**
+ * @brief 按文件格式顺序读取字段
+ */
+class Reader {
+public:
+    Reader(const char *data, size_t len) : m_cur(data), m_end(data + len) {}
+
+    template<class T>
+    bool read(T &value) {
+        if (remain() < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, m_cur, sizeof(T));
+        m_cur += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string &str) {
+        uint32_t len;
+        if (!read(len) || remain() < len) {
+            return false;
+        }
+        str.assign(m_cur, len);
+        m_cur += len;
+        return true;
+    }
+
+    bool skip(size_t len) {
+        if (remain() < len) {
+            return false;
+        }
+        m_cur += len;
+        return true;
+    }
+
+    const char* cur() const {return m_cur;}
+
+    size_t remain() const {return static_cast<size_t>(m_end - m_cur);}
+
+private:
+    const char *m_cur;
+    const char *m_end;
+};
+
+const char* kDefaultPattern = "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n";
+
+/**
+ * @brief 解码一个文件
+ * @return 文件是否完整
+ */
+bool decode(const std::string &filename, const KAFKA::LogFormatter::LogFormatterPtr &formatter) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        std::cerr << "kafka-logdecode: cannot open " << filename << std::endl;
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string content = ss.str();
+
+    const std::string magic = KAFKA::BinaryLog::Magic();
+    Reader reader(content.data(), content.size());
+    std::map<uint32_t, Site> sites;
+    KAFKA::Logger::LoggerPtr logger;
+    uint32_t version = 0;
+    std::string name;
+    //版本2的记录保存LogClock时间戳，加上该值为墙上时间
+    int64_t wallOffset = 0;
+    KAFKA::LogBuffer out;
+    std::string text;
+
+    while (reader.remain()) {
+        //同一文件可能被多次打开追加，每次都以文件头开始
+        if (reader.remain() >= magic.size() && memcmp(reader.cur(), magic.data(), magic.size()) == 0) {
+            reader.skip(magic.size());
+            if (!reader.read(version) || (version >= 2 && !reader.read(wallOffset)) || !reader.readString(name)) {
+                break;
+            }
+            if (version < 1 || version > KAFKA::BinaryLog::kVersion) {
+                std::cerr << "kafka-logdecode: " << filename << ": unsupported version " << version << std::endl;
+                return false;
+            }
+            logger.reset(new KAFKA::Logger(name));
+            sites.clear();
+            continue;
+        }
+        if (!logger) {
+            std::cerr << "kafka-logdecode: " << filename << ": not a binary log file" << std::endl;
+            return false;
+        }
+
+        uint8_t type;
+        uint32_t len;
+        if (!reader.read(type) || !reader.read(len) || reader.remain() < len) {
+            break;
+        }
+        Reader frame(reader.cur(), len);
+        reader.skip(len);
+
+        uint32_t id;
+        if (!frame.read(id)) {
+            break;
+        }
+        if (type == KAFKA::BinaryLog::kSiteFrame) {
+            Site &site = sites[id];
+            if (!frame.read(site.line) || !frame.readString(site.file)
+                || !frame.readString(site.format) || !frame.readString(site.argTypes)) {
+                break;
+            }
+            continue;
+        }
+        if (type == KAFKA::LogFlightRecorder::kBacktraceFrame) {
+            //LogFlightRecorder写出的调用栈，id为信号
+            fflush(stdout);
+            printf("backtrace (signal %u):\n", id);
+            fwrite(frame.cur(), 1, frame.remain(), stdout);
+            continue;
+        }
+        if (type != KAFKA::BinaryLog::kRecordFrame) {
+            //未知的帧类型，跳过
+            continue;
+        }
+
+        auto it = sites.find(id);
+        uint8_t level;
+        uint64_t sec;
+        uint32_t nsec = 0, elapse, threadId, fiberId;
+        std::string threadName;
+        if (it == sites.end() || !frame.read(level) || !frame.read(sec) || (version < 2 && !frame.read(nsec))
+            || !frame.read(elapse) || !frame.read(threadId) || !frame.read(fiberId)
+            || !frame.readString(threadName)) {
+            std::cerr << "kafka-logdecode: " << filename << ": bad record of site " << id << std::endl;
+            continue;
+        }
+        const Site &site = it->second;
+        text.clear();
+        if (!KAFKA::BinaryLog::Render(site.format.c_str(), site.argTypes.c_str(), frame.cur(), frame.remain(), text)) {
+            std::cerr << "kafka-logdecode: " << filename << ": bad arguments of site " << id << std::endl;
+        }
+
+        //版本2中sec为时间戳
+        uint64_t timestamp = version >= 2 ? sec : 0;
+        if (version >= 2) {
+            uint64_t wall = sec + wallOffset;
+            sec = wall / 1000000000;
+            nsec = static_cast<uint32_t>(wall % 1000000000);
+        }
+        KAFKA::LogEvent::LogEventPtr event(new KAFKA::LogEvent(logger, static_cast<KAFKA::LogLevel::Level>(level),
+                                                               site.file.c_str(), site.line, elapse,
+                                                               threadId, fiberId, timestamp, threadName));
+        event->setTime(sec, nsec);
+        event->getSS() << text;
+        out.clear();
+        formatter->format(out, logger, event->getLevel(), event);
+        fwrite(out.data(), 1, out.size(), stdout);
+    }
+
+    if (reader.remain()) {
+        std::cerr << "kafka-logdecode: " << filename << ": truncated at offset "
+                  << content.size() - reader.remain() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::string pattern = kDefaultPattern;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            pattern = argv[++i];
+        }
+        else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "usage: kafka-logdecode [-p pattern] file..." << std::endl;
+        return 2;
+    }
+
+    KAFKA::LogFormatter::LogFormatterPtr formatter(new KAFKA::LogFormatter(pattern));
+    if (formatter->isError()) {
+        std::cerr << "kafka-logdecode: invalid pattern " << pattern << std::endl;
+        return 2;
+    }
+    bool ok = true;
+    for (auto &file : files) {
+        ok = decode(file, formatter) && ok;
+    }
+    fflush(stdout);
+    return ok ? 0 : 1;
+}